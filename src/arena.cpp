@@ -0,0 +1,73 @@
+#include "arena.h"
+#include <cstdlib>
+#include <cstdint>
+
+Arena::Arena()
+    : chunks(std::vector<char *>()),
+      current(NULL),
+      remaining(0),
+      chunk_size(first_chunk_size),
+      total(0),
+      released(std::map<size_t, std::vector<void *> >())
+{
+}
+
+Arena::~Arena()
+{
+    for (std::vector<char *>::iterator chunk = chunks.begin();
+         chunk != chunks.end(); ++chunk)
+    {
+        free(*chunk);
+    }
+}
+
+void * Arena::allocate(size_t bytes, size_t alignment)
+{
+    std::map<size_t, std::vector<void *> >::iterator blocks = released.find(bytes);
+    if (blocks != released.end() && !blocks->second.empty()
+        && reinterpret_cast<uintptr_t>(blocks->second.back()) % alignment == 0)
+    {
+        void * result = blocks->second.back();
+        blocks->second.pop_back();
+        return result;
+    }
+
+    size_t padding = (alignment - reinterpret_cast<uintptr_t>(current) % alignment) % alignment;
+    if (current == NULL || padding + bytes > remaining)
+    {
+        // Oversized requests get their own chunk so the current one
+        // can keep serving small objects
+        size_t size = chunk_size;
+        if (bytes + alignment > size)
+            size = bytes + alignment;
+
+        char * chunk = static_cast<char *>(malloc(size));
+        if (chunk == NULL)
+            throw std::bad_alloc();
+        chunks.push_back(chunk);
+        total += size;
+
+        if (size > chunk_size)
+        {
+            padding = (alignment - reinterpret_cast<uintptr_t>(chunk) % alignment) % alignment;
+            return chunk + padding;
+        }
+
+        current = chunk;
+        remaining = size;
+        if (chunk_size < max_chunk_size)
+            chunk_size *= 2;
+        padding = (alignment - reinterpret_cast<uintptr_t>(current) % alignment) % alignment;
+    }
+
+    void * result = current + padding;
+    current += padding + bytes;
+    remaining -= padding + bytes;
+    return result;
+}
+
+void Arena::release(void * block, size_t bytes)
+{
+    if (block != NULL && bytes > 0)
+        released[bytes].push_back(block);
+}
@@ -0,0 +1,99 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <cstddef>
+#include <vector>
+#include <map>
+#include <new>
+#include <utility>
+#include <limits>
+
+// Bump allocator for objects that share the lifetime of a Trace. Memory is
+// carved out of large chunks and released all at once when the arena is
+// destroyed. Destructors of objects placed here are never run, so they
+// must not own memory outside the arena. Blocks given back early, such as
+// the old buffer of a growing vector, are kept by size for reuse.
+class Arena
+{
+public:
+    Arena();
+    ~Arena();
+
+    void * allocate(size_t bytes, size_t alignment);
+    void release(void * block, size_t bytes);
+
+    template <typename T, typename... Args>
+    T * make(Args&&... args)
+    {
+        return new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+    }
+
+    size_t reserved() const { return total; }
+
+    // Chunks double from the first size up to the last, so small traces
+    // stay small and big ones end up in a handful of mmap-sized regions
+    static const size_t first_chunk_size = 1 << 20;
+    static const size_t max_chunk_size = 64 << 20;
+
+private:
+    Arena(const Arena&);
+    Arena& operator=(const Arena&);
+
+    std::vector<char *> chunks;
+    char * current;
+    size_t remaining;
+    size_t chunk_size;
+    size_t total;
+    std::map<size_t, std::vector<void *> > released; // Blocks by size
+};
+
+// STL allocator drawing from an Arena. Deallocated blocks go back to the
+// arena for the next allocation of the same size.
+template <typename T>
+class ArenaAllocator
+{
+public:
+    typedef T value_type;
+    typedef T * pointer;
+    typedef const T * const_pointer;
+    typedef T& reference;
+    typedef const T& const_reference;
+    typedef size_t size_type;
+    typedef ptrdiff_t difference_type;
+
+    template <typename U>
+    struct rebind { typedef ArenaAllocator<U> other; };
+
+    ArenaAllocator(Arena * _arena) : arena(_arena) {}
+    template <typename U>
+    ArenaAllocator(const ArenaAllocator<U>& other) : arena(other.arena) {}
+
+    T * allocate(size_t n, const void * = 0)
+    {
+        return static_cast<T *>(arena->allocate(n * sizeof(T), alignof(T)));
+    }
+    void deallocate(T * p, size_t n) { arena->release(p, n * sizeof(T)); }
+
+    template <typename U, typename... Args>
+    void construct(U * p, Args&&... args) { new (p) U(std::forward<Args>(args)...); }
+    template <typename U>
+    void destroy(U * p) { p->~U(); }
+
+    size_t max_size() const { return std::numeric_limits<size_t>::max() / sizeof(T); }
+
+    Arena * arena;
+};
+
+template <typename T, typename U>
+bool operator==(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b)
+{
+    return a.arena == b.arena;
+}
+
+template <typename T, typename U>
+bool operator!=(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b)
+{
+    return a.arena != b.arena;
+}
+
+#endif // ARENA_H
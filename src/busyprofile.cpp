@@ -0,0 +1,63 @@
+#include "busyprofile.h"
+
+BusyProfile::BusyProfile(unsigned long long _start, unsigned long long _bin_width,
+                         unsigned long _bins)
+    : start(_start),
+      bin_width(_bin_width),
+      bins(_bins),
+      cumulative(std::vector<unsigned long long>(_bins + 1, 0)),
+      covered(std::vector<long>(_bins + 1, 0))
+{
+}
+
+void BusyProfile::add(unsigned long long enter, unsigned long long exit)
+{
+    unsigned long long end = start + bins * bin_width;
+    if (enter < start)
+        enter = start;
+    if (exit > end)
+        exit = end;
+    if (exit <= enter)
+        return;
+
+    unsigned long first = (enter - start) / bin_width;
+    unsigned long last = (exit - start) / bin_width;
+    if (first == last)
+    {
+        cumulative[first] += exit - enter;
+        return;
+    }
+
+    cumulative[first] += start + (first + 1) * bin_width - enter;
+    if (last < bins)
+        cumulative[last] += exit - (start + last * bin_width);
+    covered[first + 1]++;
+    covered[last]--;
+}
+
+void BusyProfile::finish()
+{
+    unsigned long long total = 0;
+    long running = 0;
+    for (unsigned long bin = 0; bin < bins; bin++)
+    {
+        running += covered[bin];
+        unsigned long long busy = cumulative[bin] + running * bin_width;
+        cumulative[bin] = total;
+        total += busy;
+    }
+    cumulative[bins] = total;
+    std::vector<long>().swap(covered);
+}
+
+double BusyProfile::busyBefore(double time) const
+{
+    if (time <= start)
+        return 0;
+
+    double offset = (time - start) / bin_width;
+    unsigned long bin = static_cast<unsigned long>(offset);
+    if (bin >= bins)
+        return cumulative[bins];
+    return cumulative[bin] + (offset - bin) * (cumulative[bin + 1] - cumulative[bin]);
+}
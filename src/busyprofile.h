@@ -0,0 +1,36 @@
+#ifndef BUSYPROFILE_H
+#define BUSYPROFILE_H
+
+#include <vector>
+
+// Running total of busy time over fixed width bins from start. Events are
+// added once at load and then busy time over any interval is the
+// difference of two lookups, interpolated within a bin.
+class BusyProfile
+{
+public:
+    BusyProfile(unsigned long long _start, unsigned long long _bin_width,
+                unsigned long _bins);
+
+    // Clipped to the bins
+    void add(unsigned long long enter, unsigned long long exit);
+
+    // Call once after the last add
+    void finish();
+
+    // Busy time between start and time
+    double busyBefore(double time) const;
+
+    unsigned long long start;
+    unsigned long long bin_width;
+    unsigned long bins;
+
+private:
+    // Before finish, the busy time in each bin from partly covering
+    // events and a difference array of bins covered whole. After, busy
+    // time before each bin.
+    std::vector<unsigned long long> cumulative;
+    std::vector<long> covered;
+};
+
+#endif // BUSYPROFILE_H
@@ -0,0 +1,203 @@
+#include "callingcontexttree.h"
+#include "event.h"
+#include "ravelutils.h"
+#include <algorithm>
+#include <map>
+
+CallingContextTree::CallingContextTree()
+    : nodes(std::vector<Node>()),
+      event_nodes(std::vector<unsigned long>()),
+      run_offsets(std::vector<unsigned long>()),
+      run_list(std::vector<Run>()),
+      enters(std::vector<unsigned long long>()),
+      exits(std::vector<unsigned long long>()),
+      enter_sums(std::vector<unsigned long long>()),
+      exit_sums(std::vector<unsigned long long>())
+{
+}
+
+void CallingContextTree::build(std::vector<std::vector<Event *> *> * events,
+                               std::vector<std::vector<Event *> *> * roots,
+                               std::vector<unsigned long> * event_offsets,
+                               std::vector<unsigned long long> * self_times)
+{
+    typedef std::map<std::pair<unsigned long, int>, unsigned long> ChildMap;
+    const Node root = { -1, 0, -1, 0, 0, 0 };
+
+    // Each entity's own tree, with the local node of each of its events
+    std::vector<std::vector<Node> > local_nodes(events->size());
+    std::vector<std::vector<unsigned long> > local_events(events->size());
+    RavelUtils::parallelFor(0, events->size(),
+        [events, roots, event_offsets, self_times, &local_nodes, &local_events, &root](unsigned long entity) {
+        std::vector<Node>& tree = local_nodes[entity];
+        std::vector<unsigned long>& event_node = local_events[entity];
+        ChildMap children = ChildMap();
+        tree.push_back(root);
+        event_node.assign(events->at(entity)->size(), 0);
+
+        std::vector<std::pair<Event *, unsigned long> > stack;
+        std::vector<Event *> * entity_roots = roots->at(entity);
+        for (std::vector<Event *>::reverse_iterator evt = entity_roots->rbegin();
+             evt != entity_roots->rend(); ++evt)
+        {
+            stack.push_back(std::make_pair(*evt, 0));
+        }
+        while (!stack.empty())
+        {
+            Event * evt = stack.back().first;
+            unsigned long parent = stack.back().second;
+            stack.pop_back();
+
+            std::pair<ChildMap::iterator, bool> child
+                = children.insert(std::make_pair(std::make_pair(parent, evt->function), tree.size()));
+            if (child.second)
+            {
+                Node node = { evt->function, parent, tree[parent].depth + 1, 0, 0, 0 };
+                tree.push_back(node);
+            }
+            Node& node = tree[child.first->second];
+            node.count++;
+            node.inclusive += evt->exit - evt->enter;
+            node.exclusive += self_times->at(event_offsets->at(entity) + evt->index);
+            event_node[evt->index] = child.first->second;
+
+            for (Event::CalleeList::reverse_iterator callee = evt->callees->rbegin();
+                 callee != evt->callees->rend(); ++callee)
+            {
+                stack.push_back(std::make_pair(*callee, child.first->second));
+            }
+        }
+    });
+
+    // Fold the entity trees into the shared one. Local parents come before
+    // their children, so they are always mapped first.
+    nodes.clear();
+    nodes.push_back(root);
+    ChildMap children = ChildMap();
+    std::vector<std::vector<unsigned long> > mappings(events->size());
+    for (unsigned long entity = 0; entity < events->size(); entity++)
+    {
+        std::vector<Node>& tree = local_nodes[entity];
+        std::vector<unsigned long>& mapping = mappings[entity];
+        mapping.assign(tree.size(), 0);
+        for (unsigned long local = 1; local < tree.size(); local++)
+        {
+            unsigned long parent = mapping[tree[local].parent];
+            std::pair<ChildMap::iterator, bool> child
+                = children.insert(std::make_pair(std::make_pair(parent, tree[local].function), nodes.size()));
+            if (child.second)
+            {
+                Node node = { tree[local].function, parent, nodes[parent].depth + 1, 0, 0, 0 };
+                nodes.push_back(node);
+            }
+            Node& node = nodes[child.first->second];
+            node.count += tree[local].count;
+            node.inclusive += tree[local].inclusive;
+            node.exclusive += tree[local].exclusive;
+            mapping[local] = child.first->second;
+        }
+        std::vector<Node>().swap(tree);
+    }
+    for (unsigned long n = 1; n < nodes.size(); n++)
+    {
+        if (nodes[n].parent == 0)
+            nodes[0].inclusive += nodes[n].inclusive;
+    }
+
+    event_nodes.assign(event_offsets->back(), 0);
+    RavelUtils::parallelFor(0, events->size(), [this, event_offsets, &local_events, &mappings](unsigned long entity) {
+        std::vector<unsigned long>& event_node = local_events[entity];
+        for (unsigned long index = 0; index < event_node.size(); index++)
+            event_nodes[event_offsets->at(entity) + index] = mappings[entity][event_node[index]];
+    });
+
+    // Calls of each node grouped by entity, as events are visited by entity
+    std::vector<unsigned long> node_offsets(nodes.size() + 1, 0);
+    for (unsigned long n = 0; n < nodes.size(); n++)
+        node_offsets[n + 1] = node_offsets[n] + nodes[n].count;
+    std::vector<unsigned long> cursor(node_offsets.begin(), node_offsets.end() - 1);
+    std::vector<unsigned long> position_entity(node_offsets.back(), 0);
+    enters.assign(node_offsets.back(), 0);
+    exits.assign(node_offsets.back(), 0);
+    for (unsigned long entity = 0; entity < events->size(); entity++)
+    {
+        std::vector<Event *> * entity_events = events->at(entity);
+        for (unsigned long index = 0; index < entity_events->size(); index++)
+        {
+            unsigned long n = event_nodes[event_offsets->at(entity) + index];
+            if (n == 0)
+                continue;
+            unsigned long position = cursor[n]++;
+            enters[position] = entity_events->at(index)->enter;
+            exits[position] = entity_events->at(index)->exit;
+            position_entity[position] = entity;
+        }
+    }
+
+    run_offsets.clear();
+    run_list.clear();
+    for (unsigned long n = 0; n < nodes.size(); n++)
+    {
+        run_offsets.push_back(run_list.size());
+        for (unsigned long position = node_offsets[n]; position < node_offsets[n + 1]; position++)
+        {
+            if (position == node_offsets[n] || position_entity[position] != run_list.back().entity)
+            {
+                Run run = { position_entity[position], position, position };
+                run_list.push_back(run);
+            }
+            run_list.back().end = position + 1;
+        }
+    }
+    run_offsets.push_back(run_list.size());
+
+    RavelUtils::parallelFor(0, run_list.size(), [this](unsigned long r) {
+        std::sort(enters.begin() + run_list[r].begin, enters.begin() + run_list[r].end);
+        std::sort(exits.begin() + run_list[r].begin, exits.begin() + run_list[r].end);
+    });
+
+    enter_sums.assign(enters.size() + 1, 0);
+    exit_sums.assign(exits.size() + 1, 0);
+    for (unsigned long position = 0; position < enters.size(); position++)
+    {
+        enter_sums[position + 1] = enter_sums[position] + enters[position];
+        exit_sums[position + 1] = exit_sums[position] + exits[position];
+    }
+}
+
+// Over the calls overlapping the window, the inclusive time is the sum of
+// their exits capped at stop less the sum of their enters raised to start,
+// and both sums split into counts and sums of sorted enters and exits
+void CallingContextTree::window(unsigned long node, unsigned long long start, unsigned long long stop,
+                                unsigned long entity_start, unsigned long entity_stop,
+                                unsigned long long * count, unsigned long long * inclusive) const
+{
+    *count = 0;
+    *inclusive = 0;
+    if (start >= stop)
+        return;
+
+    std::vector<Run>::const_iterator last = run_list.begin() + run_offsets[node + 1];
+    for (std::vector<Run>::const_iterator run
+            = std::lower_bound(run_list.begin() + run_offsets[node], last,
+                               entity_start, runEntityLessThan);
+         run != last && run->entity < entity_stop; ++run)
+    {
+        std::vector<unsigned long long>::const_iterator first_enter = enters.begin() + run->begin;
+        std::vector<unsigned long long>::const_iterator last_enter = enters.begin() + run->end;
+        std::vector<unsigned long long>::const_iterator first_exit = exits.begin() + run->begin;
+        std::vector<unsigned long long>::const_iterator last_exit = exits.begin() + run->end;
+        unsigned long entered_by_start = std::upper_bound(first_enter, last_enter, start) - enters.begin();
+        unsigned long entered_by_stop = std::lower_bound(first_enter, last_enter, stop) - enters.begin();
+        unsigned long exited_by_start = std::upper_bound(first_exit, last_exit, start) - exits.begin();
+        unsigned long exited_by_stop = std::lower_bound(first_exit, last_exit, stop) - exits.begin();
+
+        unsigned long long capped_exits = exit_sums[exited_by_stop] - exit_sums[exited_by_start]
+                                          + stop * (entered_by_stop - exited_by_stop);
+        unsigned long long raised_enters = start * ((entered_by_start - run->begin)
+                                                    - (exited_by_start - run->begin))
+                                           + enter_sums[entered_by_stop] - enter_sums[entered_by_start];
+        *count += entered_by_stop - exited_by_start;
+        *inclusive += capped_exits - raised_enters;
+    }
+}
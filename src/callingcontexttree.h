@@ -0,0 +1,65 @@
+#ifndef CALLINGCONTEXTTREE_H
+#define CALLINGCONTEXTTREE_H
+
+#include <vector>
+
+class Event;
+
+// Every entity's call trees merged by call path. Each entity's tree is
+// built in parallel and then folded into the shared tree, recording the
+// node of every event. The calls at a node are also kept per entity with
+// their enters and exits sorted and summed, so the calls and inclusive
+// time of any node in a window take four binary searches per entity.
+class CallingContextTree
+{
+public:
+    CallingContextTree();
+
+    // Callee lists must already be sorted by enter
+    void build(std::vector<std::vector<Event *> *> * events,
+               std::vector<std::vector<Event *> *> * roots,
+               std::vector<unsigned long> * event_offsets,
+               std::vector<unsigned long long> * self_times);
+
+    struct Node {
+        int function; // -1 for the root
+        unsigned long parent;
+        int depth;
+        unsigned long long count;
+        unsigned long long inclusive;
+        unsigned long long exclusive;
+    };
+
+    // Calls and inclusive time of node from start to stop on entities
+    // entity_start up to entity_stop
+    void window(unsigned long node, unsigned long long start, unsigned long long stop,
+                unsigned long entity_start, unsigned long entity_stop,
+                unsigned long long * count, unsigned long long * inclusive) const;
+
+    // Node 0 is the root above every call tree. Parents come before
+    // their children.
+    std::vector<Node> nodes;
+    std::vector<unsigned long> event_nodes; // By position from event_offsets
+
+private:
+    struct Run {
+        unsigned long entity;
+        unsigned long begin;
+        unsigned long end;
+    };
+    static bool runEntityLessThan(const Run& run, unsigned long entity)
+    {
+        return run.entity < entity;
+    }
+
+    std::vector<unsigned long> run_offsets; // Runs of node i from run_offsets[i]
+    std::vector<Run> run_list;
+    // Enters and exits sorted within each run, with running sums. The sums
+    // may wrap, but the window time taken from them is exact.
+    std::vector<unsigned long long> enters;
+    std::vector<unsigned long long> exits;
+    std::vector<unsigned long long> enter_sums; // Of enters before each position
+    std::vector<unsigned long long> exit_sums;
+};
+
+#endif // CALLINGCONTEXTTREE_H
@@ -6,7 +6,6 @@
 #include <vector>
 #include <map>
 
-class Message;
 class CollectiveRecord;
 class Metrics;
 
@@ -29,7 +28,6 @@ public:
     virtual bool isReceive() const { return false; }
     virtual bool isCollective() { return false; }
 
-    virtual std::vector<Message *> * getMessages() { return NULL; }
     virtual CollectiveRecord * getCollective() { return NULL; }
 
     CommEvent * comm_next;
@@ -1,5 +1,4 @@
 #include "commrecord.h"
-#include "message.h"
 #include <cstdlib>
 
 CommRecord::CommRecord(unsigned long _s, unsigned long long int _st,
@@ -8,7 +7,7 @@ CommRecord::CommRecord(unsigned long _s, unsigned long long int _st,
                        unsigned long long _request) :
     sender(_s), send_time(_st), receiver(_r), recv_time(_rt),
     size(_size), tag(_tag), group(_group), send_request(_request),
-    send_complete(0), matched(false), message(NULL)
+    send_complete(0), matched(false), message(-1)
 {
 }
 
@@ -1,8 +1,6 @@
 #ifndef COMMRECORD_H
 #define COMMRECORD_H
 
-class Message;
-
 // Holder of OTF Comm Info
 class CommRecord
 {
@@ -26,7 +24,7 @@ public:
     unsigned long long int send_complete;
     bool matched;
 
-    Message * message;
+    long message; // Index into Trace::messages, -1 until created
 
     bool operator<(const  CommRecord &);
     bool operator>(const  CommRecord &);
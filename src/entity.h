@@ -1,17 +1,17 @@
 #ifndef ENTITY_H
 #define ENTITY_H
 
-#include <string>
+#include "stringpool.h"
 
 class PrimaryEntityGroup;
 
 class Entity
 {
 public:
-    Entity(unsigned long _id, std::string _name, PrimaryEntityGroup * _primary);
+    Entity(unsigned long _id, StringPool::Handle _name, PrimaryEntityGroup * _primary);
 
     unsigned long id;
-    std::string name;
+    StringPool::Handle name;
 
     PrimaryEntityGroup * primary;
 };
@@ -1,6 +1,6 @@
 #include "entitygroup.h"
 
-EntityGroup::EntityGroup(int _id, std::string _name)
+EntityGroup::EntityGroup(int _id, StringPool::Handle _name)
     : id(_id),
       name(_name),
       entities(new std::vector<unsigned long long>()),
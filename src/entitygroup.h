@@ -1,19 +1,19 @@
 #ifndef ENTITYGROUP_H
 #define ENTITYGROUP_H
 
-#include <string>
 #include <vector>
 #include <map>
+#include "stringpool.h"
 
 // This class is for sub-groupings and reorderings of existing PrimaryEntityGroups.
 class EntityGroup
 {
 public:
-    EntityGroup(int _id, std::string _name);
+    EntityGroup(int _id, StringPool::Handle _name);
     ~EntityGroup() { delete entities; delete entityorder; }
 
     int id;
-    std::string name;
+    StringPool::Handle name;
     // May need to keep additional names if we have several that are the same
 
     // This order is important for communicator rank ID
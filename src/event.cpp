@@ -9,23 +9,23 @@ Event::Event(unsigned long long _enter, unsigned long long _exit,
       guid(0),
       parent_guid(0),
       caller(NULL),
-      callees(new std::vector<Event *>()),
+      callees(NULL),
       enter(_enter),
       exit(_exit),
+      prefix_exit(_exit),
       function(_function),
       entity(_entity),
       pe(_pe),
+      index(0),
       depth(-1),
-      metrics(new Metrics())
+      metrics(NULL)
 {
 
 }
 
+// Callees and metrics belong to the trace arena
 Event::~Event()
 {
-    delete metrics;
-    if (callees)
-        delete callees;
 }
 
 bool Event::operator<(const Event &event)
@@ -74,8 +74,8 @@ Event * Event::findChild(unsigned long long time)
     if (enter <= time && exit >= time)
     {
         result = this;
-        for (std::vector<Event *>::iterator child = callees->begin();
-             child != callees->end(); ++child)
+        for (CalleeList::iterator child = firstActiveAt(callees->begin(), callees->end(), time);
+             child != callees->end() && (*child)->enter <= time; ++child)
         {
             child_match = (*child)->findChild(time);
             if (child_match)
@@ -91,7 +91,7 @@ Event * Event::findChild(unsigned long long time)
 unsigned long long Event::getVisibleEnd(unsigned long long start)
 {
     unsigned long long end = exit;
-    for (std::vector<Event *>::iterator child = callees->begin();
+    for (CalleeList::iterator child = callees->begin();
          child != callees->end(); ++child)
     {
         if ((*child)->enter > start)
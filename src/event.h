@@ -5,15 +5,20 @@
 #include <string>
 #include <otf2/otf2.h>
 #include <nlohmann/json.hpp>
+#include "arena.h"
 
 class Function;
 class Metrics;
 
 using json = nlohmann::json;
 
+// Events are placed in their Trace's arena by OTFConverter, which also
+// provides the arena-backed callee list and metrics.
 class Event
 {
 public:
+    typedef std::vector<Event *, ArenaAllocator<Event *> > CalleeList;
+
     Event(unsigned long long _enter, unsigned long long _exit, int _function,
           unsigned long _entity, unsigned long _pe);
     ~Event();
@@ -28,6 +33,27 @@ public:
     {
         return evt1->entity < evt2->entity;
     }
+    static bool eventEnterLessThan(const Event * evt1, const Event * evt2)
+    {
+        return evt1->enter < evt2->enter;
+    }
+
+    // Siblings (roots or callees) are kept sorted by enter with
+    // prefix_exit set by Trace::preprocess. Every sibling before the one
+    // returned has exited before time.
+    template <typename Iterator>
+    static Iterator firstActiveAt(Iterator begin, Iterator end, unsigned long long time)
+    {
+        while (begin < end)
+        {
+            Iterator mid = begin + (end - begin) / 2;
+            if ((*mid)->prefix_exit < time)
+                begin = mid + 1;
+            else
+                end = mid;
+        }
+        return begin;
+    }
 
     Event * findChild(unsigned long long time);
     unsigned long long getVisibleEnd(unsigned long long start);
@@ -53,13 +79,15 @@ public:
 
     // Call tree info
     Event * caller;
-    std::vector<Event *> * callees;
+    CalleeList * callees;
 
     unsigned long long enter;
     unsigned long long exit;
+    unsigned long long prefix_exit; // Latest exit of this and earlier siblings
     int function;
     unsigned long entity;
     unsigned long pe;
+    unsigned long index; // Position in Trace::events for this entity
     int depth;
 
     Metrics * metrics; // Lateness or Counters etc
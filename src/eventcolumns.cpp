@@ -0,0 +1,26 @@
+#include "eventcolumns.h"
+#include "event.h"
+
+EventColumns::EventColumns()
+    : enters(std::vector<unsigned long long>()),
+      exits(std::vector<unsigned long long>()),
+      functions(std::vector<int>()),
+      depths(std::vector<int>())
+{
+}
+
+void EventColumns::build(std::vector<Event *> * events)
+{
+    enters.resize(events->size());
+    exits.resize(events->size());
+    functions.resize(events->size());
+    depths.resize(events->size());
+    for (unsigned long i = 0; i < events->size(); i++)
+    {
+        Event * evt = events->at(i);
+        enters[i] = evt->enter;
+        exits[i] = evt->exit;
+        functions[i] = evt->function;
+        depths[i] = evt->depth;
+    }
+}
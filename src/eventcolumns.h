@@ -0,0 +1,24 @@
+#ifndef EVENTCOLUMNS_H
+#define EVENTCOLUMNS_H
+
+#include <vector>
+
+class Event;
+
+// Plain columns of one entity's events, in Trace::events order, so that
+// scans over every event read contiguous arrays rather than following an
+// Event pointer each.
+class EventColumns
+{
+public:
+    EventColumns();
+
+    void build(std::vector<Event *> * events);
+
+    std::vector<unsigned long long> enters;
+    std::vector<unsigned long long> exits;
+    std::vector<int> functions;
+    std::vector<int> depths;
+};
+
+#endif // EVENTCOLUMNS_H
@@ -1,6 +1,6 @@
 #include "function.h"
 
-Function::Function(unsigned long _id, std::string _n, int _g, std::string _s, int _c)
+Function::Function(unsigned long _id, StringPool::Handle _n, int _g, StringPool::Handle _s, int _c)
     : id(_id),
       name(_n),
       shortname(_s),
@@ -9,6 +9,8 @@ Function::Function(unsigned long _id, std::string _n, int _g, std::string _s, in
       count(0),
       rank(0),
       max_length(0),
+      self_time(0),
+      wait_time(0),
       isMain(false),
       task_lengths(std::vector<unsigned long long>())
 {
@@ -20,42 +22,50 @@ void to_json(json& j, const Function& f)
 {
     j = json{
         {"id", f.id},
-        {"name", f.name},
-        {"shortname", f.shortname},
+        {"name", StringPool::get(f.name)},
+        {"shortname", StringPool::get(f.shortname)},
         {"count", std::to_string(f.count)},
         {"rank", std::to_string(f.rank)},
-        {"max_length", std::to_string(f.max_length)}
+        {"max_length", std::to_string(f.max_length)},
+        {"self_time", std::to_string(f.self_time)},
+        {"wait_time", std::to_string(f.wait_time)}
     };
 }
 
 void from_json(const json& j, Function& f)
 {
     f.id = std::stoul(j.at("id").get<std::string>());
-    f.name = j.at("name").get<std::string>();
-    f.shortname = j.at("shortname").get<std::string>();
+    f.name = StringPool::intern(j.at("name").get<std::string>());
+    f.shortname = StringPool::intern(j.at("shortname").get<std::string>());
     f.count = std::stoull(j.at("count").get<std::string>());
     f.rank = j.at("rank").get<int>();
     f.max_length = std::stoull(j.at("max_length").get<std::string>());
+    f.self_time = std::stoull(j.at("self_time").get<std::string>());
+    f.wait_time = std::stoull(j.at("wait_time").get<std::string>());
 }
 
 void to_json(json& j, const Function * f)
 {
     j = json{
         {"id", f->id},
-        {"name", f->name},
-        {"shortname", f->shortname},
+        {"name", StringPool::get(f->name)},
+        {"shortname", StringPool::get(f->shortname)},
         {"count", std::to_string(f->count)},
         {"rank", std::to_string(f->rank)},
-        {"max_length", std::to_string(f->max_length)}
+        {"max_length", std::to_string(f->max_length)},
+        {"self_time", std::to_string(f->self_time)},
+        {"wait_time", std::to_string(f->wait_time)}
     };
 }
 
 void from_json(const json& j, Function * f)
 {
     f->id = std::stoul(j.at("id").get<std::string>());
-    f->name = j.at("name").get<std::string>();
-    f->shortname = j.at("shortname").get<std::string>();
+    f->name = StringPool::intern(j.at("name").get<std::string>());
+    f->shortname = StringPool::intern(j.at("shortname").get<std::string>());
     f->count = std::stoull(j.at("count").get<std::string>());
     f->rank = j.at("rank").get<int>();
     f->max_length = std::stoull(j.at("max_length").get<std::string>());
+    f->self_time = std::stoull(j.at("self_time").get<std::string>());
+    f->wait_time = std::stoull(j.at("wait_time").get<std::string>());
 }
@@ -4,6 +4,7 @@
 #include <string>
 #include <vector>
 #include <nlohmann/json.hpp>
+#include "stringpool.h"
 
 using json = nlohmann::json;
 
@@ -11,16 +12,18 @@ using json = nlohmann::json;
 class Function
 {
 public:
-    Function(unsigned long _id, std::string _n, int _g, std::string _s = "", int _c = 0);
+    Function(unsigned long _id, StringPool::Handle _n, int _g, StringPool::Handle _s = 0, int _c = 0);
 
     unsigned long id;
-    std::string name;
-    std::string shortname;
+    StringPool::Handle name;
+    StringPool::Handle shortname;
     int group;
     int comms; // max comms in a function
     unsigned long long count; // number of times it appears in trace
     int rank; // how it comes to other functions in terms of use
     unsigned long long max_length;
+    unsigned long long self_time; // total time in the function less its callees
+    unsigned long long wait_time; // total time its comm events waited on peers
     bool isMain;
 
 
@@ -30,6 +33,10 @@ public:
     {
         return f1->count > f2->count;
     }
+    static bool functionSelfTimeGreaterThan(const Function * f1, const Function * f2)
+    {
+        return f1->self_time > f2->self_time;
+    }
 };
 
 // For visualization purposes, NOT serialization purposes
@@ -0,0 +1,86 @@
+#include "functionbusytable.h"
+#include "event.h"
+#include "busyprofile.h"
+#include "occurrenceindex.h"
+#include "ravelutils.h"
+#include <algorithm>
+
+FunctionBusyTable::FunctionBusyTable(unsigned long long _start, unsigned long long _bin_width,
+                                     unsigned long _bins)
+    : start(_start),
+      bin_width(_bin_width),
+      bins(_bins),
+      function_keys(std::vector<int>()),
+      step_offsets(std::vector<unsigned long>()),
+      steps(std::vector<Step>())
+{
+}
+
+void FunctionBusyTable::build(const OccurrenceIndex * occurrences,
+                              std::vector<std::vector<Event *> *> * events,
+                              const std::vector<int>& function_ids)
+{
+    function_keys = function_ids;
+    std::sort(function_keys.begin(), function_keys.end());
+
+    std::vector<std::vector<Step> > function_steps(function_keys.size());
+    RavelUtils::parallelFor(0, function_keys.size(), [this, occurrences, events, &function_steps](unsigned long f) {
+        BusyProfile busy(start, bin_width, bins);
+        const OccurrenceIndex::Run * first = NULL;
+        const OccurrenceIndex::Run * last = NULL;
+        occurrences->runs(function_keys[f], 0, events->size(), &first, &last);
+        for (const OccurrenceIndex::Run * run = first; run != last; ++run)
+        {
+            std::vector<Event *> * entity_events = events->at(run->entity);
+            for (unsigned long position = run->begin; position < run->end; position++)
+            {
+                Event * evt = entity_events->at(occurrences->indices[position]);
+                busy.add(evt->enter, evt->exit);
+            }
+        }
+        busy.finish();
+
+        std::vector<Step>& entries = function_steps[f];
+        Step step = { 0, 0, 0 };
+        for (unsigned long bin = 0; bin <= bins; bin++)
+        {
+            step.before = busy.busyBefore(start + bin * bin_width);
+            unsigned long long bin_busy = 0;
+            if (bin < bins)
+                bin_busy = busy.busyBefore(start + (bin + 1) * bin_width) - step.before;
+            if (bin == 0 || bin == bins || bin_busy != step.busy)
+            {
+                step.bin = bin;
+                step.busy = bin_busy;
+                entries.push_back(step);
+            }
+        }
+    });
+
+    step_offsets.assign(1, 0);
+    for (unsigned long f = 0; f < function_steps.size(); f++)
+        step_offsets.push_back(step_offsets.back() + function_steps[f].size());
+    steps.reserve(step_offsets.back());
+    for (unsigned long f = 0; f < function_steps.size(); f++)
+        steps.insert(steps.end(), function_steps[f].begin(), function_steps[f].end());
+}
+
+double FunctionBusyTable::busyBefore(int function, double time) const
+{
+    std::vector<int>::const_iterator key = std::lower_bound(function_keys.begin(),
+                                                            function_keys.end(), function);
+    if (key == function_keys.end() || *key != function || time <= start)
+        return 0;
+
+    unsigned long f = key - function_keys.begin();
+    std::vector<Step>::const_iterator first = steps.begin() + step_offsets[f];
+    std::vector<Step>::const_iterator last = steps.begin() + step_offsets[f + 1];
+    double offset = (time - start) / bin_width;
+    unsigned long bin = static_cast<unsigned long>(offset);
+    if (bin >= bins)
+        return (last - 1)->before;
+
+    // Last step at or before the bin
+    std::vector<Step>::const_iterator step = std::lower_bound(first, last, bin + 1, stepBinLessThan) - 1;
+    return step->before + (offset - step->bin) * step->busy;
+}
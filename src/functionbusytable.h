@@ -0,0 +1,50 @@
+#ifndef FUNCTIONBUSYTABLE_H
+#define FUNCTIONBUSYTABLE_H
+
+#include <vector>
+
+class Event;
+class OccurrenceIndex;
+
+// Busy time of every function over fixed width bins from start. A
+// function keeps only the bins where its busy time per bin changes, each
+// with the running total before it, so a function with few calls takes
+// few entries and one called throughout at most one per bin. Busy time up
+// to any time is then a binary search, interpolated within a bin.
+class FunctionBusyTable
+{
+public:
+    FunctionBusyTable(unsigned long long _start, unsigned long long _bin_width,
+                      unsigned long _bins);
+
+    // Functions are filled in parallel from their calls in the index
+    void build(const OccurrenceIndex * occurrences,
+               std::vector<std::vector<Event *> *> * events,
+               const std::vector<int>& function_ids);
+
+    // Busy time of a function between start and time, 0 if it has none
+    double busyBefore(int function, double time) const;
+
+    unsigned long long start;
+    unsigned long long bin_width;
+    unsigned long bins;
+
+private:
+    // Bins from this one up to the next step are each busy for busy
+    struct Step {
+        unsigned long bin;
+        unsigned long long before; // Busy time before the bin
+        unsigned long long busy;
+    };
+
+    static bool stepBinLessThan(const Step& step, unsigned long bin)
+    {
+        return step.bin < bin;
+    }
+
+    std::vector<int> function_keys; // Sorted
+    std::vector<unsigned long> step_offsets; // Into steps, one more than keys
+    std::vector<Step> steps; // Ending in a step at bins
+};
+
+#endif // FUNCTIONBUSYTABLE_H
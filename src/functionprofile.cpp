@@ -0,0 +1,120 @@
+#include "functionprofile.h"
+#include "event.h"
+#include <algorithm>
+
+FunctionProfile::FunctionProfile()
+    : occurrences(NULL),
+      functions(std::map<int, Calls>())
+{
+}
+
+void FunctionProfile::Coverage::add(unsigned long long start, unsigned long long end)
+{
+    if (end <= start)
+        return;
+    starts.push_back(start);
+    ends.push_back(end);
+}
+
+// Sort and merge the intervals and total the time before each
+void FunctionProfile::Coverage::finish()
+{
+    std::vector<std::pair<unsigned long long, unsigned long long> > intervals;
+    intervals.reserve(starts.size());
+    for (unsigned long i = 0; i < starts.size(); i++)
+        intervals.push_back(std::make_pair(starts[i], ends[i]));
+    std::sort(intervals.begin(), intervals.end());
+
+    starts.clear();
+    ends.clear();
+    for (std::vector<std::pair<unsigned long long, unsigned long long> >::iterator interval
+            = intervals.begin();
+         interval != intervals.end(); ++interval)
+    {
+        if (!ends.empty() && interval->first <= ends.back())
+        {
+            ends.back() = std::max(ends.back(), interval->second);
+            continue;
+        }
+        starts.push_back(interval->first);
+        ends.push_back(interval->second);
+    }
+
+    before.assign(starts.size(), 0);
+    for (unsigned long i = 1; i < starts.size(); i++)
+        before[i] = before[i - 1] + (ends[i - 1] - starts[i - 1]);
+
+    starts.shrink_to_fit();
+    ends.shrink_to_fit();
+}
+
+unsigned long long FunctionProfile::Coverage::coveredBefore(unsigned long long time) const
+{
+    unsigned long i = std::upper_bound(starts.begin(), starts.end(), time) - starts.begin();
+    if (i == 0)
+        return 0;
+    i--;
+    return before[i] + std::min(time, ends[i]) - starts[i];
+}
+
+void FunctionProfile::build(std::vector<Event *> * events, const OccurrenceIndex * _occurrences,
+                            unsigned long entity)
+{
+    occurrences = _occurrences;
+    functions.clear();
+    for (std::vector<Event *>::iterator evt = events->begin();
+         evt != events->end(); ++evt)
+    {
+        Calls& calls = functions[(*evt)->function];
+        calls.inclusive.add((*evt)->enter, (*evt)->exit);
+        calls.exits.push_back((*evt)->exit);
+
+        // Self time is the time between the callees
+        unsigned long long cursor = (*evt)->enter;
+        for (Event::CalleeList::iterator child = (*evt)->callees->begin();
+             child != (*evt)->callees->end(); ++child)
+        {
+            calls.exclusive.add(cursor, std::min((*child)->enter, (*evt)->exit));
+            cursor = std::max(cursor, (*child)->exit);
+        }
+        calls.exclusive.add(cursor, (*evt)->exit);
+    }
+
+    for (std::map<int, Calls>::iterator calls = functions.begin();
+         calls != functions.end(); ++calls)
+    {
+        calls->second.inclusive.finish();
+        calls->second.exclusive.finish();
+        std::sort(calls->second.exits.begin(), calls->second.exits.end());
+
+        // Every function called here has a run of this entity's calls
+        const OccurrenceIndex::Run * first = NULL;
+        const OccurrenceIndex::Run * last = NULL;
+        occurrences->runs(calls->first, entity, entity + 1, &first, &last);
+        calls->second.run = *first;
+    }
+}
+
+void FunctionProfile::window(unsigned long long start, unsigned long long stop,
+                             std::map<int, Totals>& totals) const
+{
+    for (std::map<int, Calls>::const_iterator calls = functions.begin();
+         calls != functions.end(); ++calls)
+    {
+        // Calls entering before stop less those done by start
+        unsigned long long count = (occurrences->firstFrom(calls->second.run, stop)
+                                    - calls->second.run.begin)
+                                   - (std::upper_bound(calls->second.exits.begin(),
+                                                       calls->second.exits.end(), start)
+                                      - calls->second.exits.begin());
+        if (count == 0)
+            continue;
+
+        Totals& total = totals[calls->first];
+        total.inclusive += calls->second.inclusive.coveredBefore(stop)
+                           - calls->second.inclusive.coveredBefore(start);
+        total.exclusive += calls->second.exclusive.coveredBefore(stop)
+                           - calls->second.exclusive.coveredBefore(start);
+        total.count += count;
+    }
+}
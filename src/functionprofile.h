@@ -0,0 +1,59 @@
+#ifndef FUNCTIONPROFILE_H
+#define FUNCTIONPROFILE_H
+
+#include <map>
+#include <vector>
+#include "occurrenceindex.h"
+
+class Event;
+
+// Time spent in each function on one entity, for any window. For every
+// function the entity calls, the time covered by its calls (inclusive,
+// counting recursive calls once) and by its self time (exclusive) is kept
+// as sorted disjoint intervals with the running total before each, so the
+// time inside a window is the difference of two binary searches. The
+// calls overlapping the window are counted the same way, from the sorted
+// enters of the function's run in the occurrence index and sorted exits.
+class FunctionProfile
+{
+public:
+    FunctionProfile();
+
+    // Callee lists must already be sorted by enter, and the occurrence
+    // index built and kept for as long as the profile
+    void build(std::vector<Event *> * events, const OccurrenceIndex * _occurrences,
+               unsigned long entity);
+
+    struct Totals {
+        unsigned long long inclusive;
+        unsigned long long exclusive;
+        unsigned long long count;
+    };
+
+    // Add this entity's time in start to stop to totals
+    void window(unsigned long long start, unsigned long long stop,
+                std::map<int, Totals>& totals) const;
+
+private:
+    struct Coverage {
+        std::vector<unsigned long long> starts;
+        std::vector<unsigned long long> ends;
+        std::vector<unsigned long long> before; // Covered time before each interval
+
+        void add(unsigned long long start, unsigned long long end);
+        void finish();
+        unsigned long long coveredBefore(unsigned long long time) const;
+    };
+
+    struct Calls {
+        Coverage inclusive;
+        Coverage exclusive;
+        OccurrenceIndex::Run run;
+        std::vector<unsigned long long> exits;
+    };
+
+    const OccurrenceIndex * occurrences;
+    std::map<int, Calls> functions;
+};
+
+#endif // FUNCTIONPROFILE_H
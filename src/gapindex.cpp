@@ -0,0 +1,260 @@
+#include "gapindex.h"
+#include "event.h"
+#include "ravelutils.h"
+#include <algorithm>
+
+GapIndex::GapIndex()
+    : start(0),
+      stop(0),
+      offsets(std::vector<unsigned long>(1, 0)),
+      starts(std::vector<unsigned long long>()),
+      ends(std::vector<unsigned long long>()),
+      lengths(std::vector<unsigned long long>()),
+      length_sums(std::vector<unsigned long long>(1, 0)),
+      block_offsets(std::vector<unsigned long>(1, 0)),
+      longest_table(std::vector<std::vector<unsigned long> >())
+{
+}
+
+void GapIndex::keep(std::vector<Gap>& heap, const Gap& gap, unsigned long k)
+{
+    if (heap.size() < k)
+    {
+        heap.push_back(gap);
+        std::push_heap(heap.begin(), heap.end(), gapLongerThan);
+    }
+    else if (k > 0 && gapLongerThan(gap, heap.front()))
+    {
+        std::pop_heap(heap.begin(), heap.end(), gapLongerThan);
+        heap.back() = gap;
+        std::push_heap(heap.begin(), heap.end(), gapLongerThan);
+    }
+}
+
+void GapIndex::finish(std::vector<Gap>& heap)
+{
+    std::sort_heap(heap.begin(), heap.end(), gapLongerThan);
+}
+
+void GapIndex::build(std::vector<std::vector<Event *> *> * roots,
+                     unsigned long long _start, unsigned long long _stop)
+{
+    start = _start;
+    stop = _stop;
+
+    // Each entity's gaps in time order, as start and end
+    std::vector<std::vector<std::pair<unsigned long long, unsigned long long> > > entity_gaps(roots->size());
+    RavelUtils::parallelFor(0, roots->size(), [this, roots, &entity_gaps](unsigned long entity) {
+        std::vector<std::pair<unsigned long long, unsigned long long> >& gaps = entity_gaps[entity];
+        unsigned long long covered = start;
+        for (std::vector<Event *>::iterator root = roots->at(entity)->begin();
+             root != roots->at(entity)->end(); ++root)
+        {
+            if ((*root)->enter > covered)
+                gaps.push_back(std::make_pair(covered, (*root)->enter));
+            covered = std::max(covered, (*root)->exit);
+        }
+        if (stop > covered)
+            gaps.push_back(std::make_pair(covered, stop));
+    });
+
+    offsets.assign(1, 0);
+    block_offsets.assign(1, 0);
+    starts.clear();
+    ends.clear();
+    lengths.clear();
+    length_sums.assign(1, 0);
+    for (unsigned long entity = 0; entity < entity_gaps.size(); entity++)
+    {
+        std::vector<std::pair<unsigned long long, unsigned long long> >& gaps = entity_gaps[entity];
+        for (std::vector<std::pair<unsigned long long, unsigned long long> >::iterator gap = gaps.begin();
+             gap != gaps.end(); ++gap)
+        {
+            starts.push_back(gap->first);
+            ends.push_back(gap->second);
+            lengths.push_back(gap->second - gap->first);
+            length_sums.push_back(length_sums.back() + lengths.back());
+        }
+        offsets.push_back(starts.size());
+        block_offsets.push_back(block_offsets.back() + (gaps.size() + block_size - 1) / block_size);
+        std::vector<std::pair<unsigned long long, unsigned long long> >().swap(gaps);
+    }
+
+    // Longest gap of each block, then of runs of blocks doubling in length
+    unsigned long blocks = block_offsets.back();
+    longest_table.assign(1, std::vector<unsigned long>(blocks, 0));
+    RavelUtils::parallelFor(0, roots->size(), [this](unsigned long entity) {
+        for (unsigned long block = block_offsets[entity]; block < block_offsets[entity + 1]; block++)
+        {
+            unsigned long first = offsets[entity] + (block - block_offsets[entity]) * block_size;
+            unsigned long last = std::min(first + block_size, offsets[entity + 1]);
+            unsigned long best = first;
+            for (unsigned long g = first + 1; g < last; g++)
+                best = longerOf(best, g);
+            longest_table[0][block] = best;
+        }
+    });
+    for (unsigned long level = 1; (1UL << level) <= blocks; level++)
+    {
+        longest_table.push_back(std::vector<unsigned long>(blocks - (1UL << level) + 1, 0));
+        std::vector<unsigned long>& lower = longest_table[level - 1];
+        std::vector<unsigned long>& table = longest_table[level];
+        unsigned long half = 1UL << (level - 1);
+        RavelUtils::parallelFor(0, table.size(), [this, &lower, &table, half](unsigned long block) {
+            table[block] = longerOf(lower[block], lower[block + half]);
+        });
+    }
+}
+
+GapIndex::Gap GapIndex::clipped(unsigned long entity, unsigned long g,
+                                unsigned long long start, unsigned long long stop) const
+{
+    Gap gap = { starts[g], lengths[g], entity,
+                std::min(ends[g], stop) - std::max(starts[g], start) };
+    return gap;
+}
+
+unsigned long GapIndex::longestIn(unsigned long entity, unsigned long first, unsigned long last) const
+{
+    unsigned long base = offsets[entity];
+    unsigned long first_block = (first - base + block_size - 1) / block_size;
+    unsigned long last_block = (last - base) / block_size;
+    unsigned long best = first;
+    if (first_block >= last_block)
+    {
+        for (unsigned long g = first + 1; g < last; g++)
+            best = longerOf(best, g);
+        return best;
+    }
+
+    for (unsigned long g = first + 1; g < base + first_block * block_size; g++)
+        best = longerOf(best, g);
+    unsigned long level = 0;
+    while ((2UL << level) <= last_block - first_block)
+        level++;
+    unsigned long left = block_offsets[entity] + first_block;
+    unsigned long right = block_offsets[entity] + last_block - (1UL << level);
+    best = longerOf(best, longerOf(longest_table[level][left], longest_table[level][right]));
+    for (unsigned long g = base + last_block * block_size; g < last; g++)
+        best = longerOf(best, g);
+    return best;
+}
+
+GapIndex::Summary GapIndex::summary(unsigned long entity) const
+{
+    Summary summary = { offsets[entity + 1] - offsets[entity],
+                        length_sums[offsets[entity + 1]] - length_sums[offsets[entity]],
+                        0 };
+    if (summary.count > 0)
+        summary.longest = lengths[longestIn(entity, offsets[entity], offsets[entity + 1])];
+    return summary;
+}
+
+// Gaps from the first ending after start up to the first starting at or
+// after stop overlap the window, and only the two at its edges can stick
+// out of it
+unsigned long long GapIndex::idleTime(unsigned long entity, unsigned long long start,
+                                      unsigned long long stop) const
+{
+    if (start >= stop)
+        return 0;
+
+    unsigned long first = std::upper_bound(ends.begin() + offsets[entity], ends.begin() + offsets[entity + 1],
+                                           start) - ends.begin();
+    unsigned long last = std::lower_bound(starts.begin() + offsets[entity], starts.begin() + offsets[entity + 1],
+                                          stop) - starts.begin();
+    if (first >= last)
+        return 0;
+
+    unsigned long long idle = length_sums[last] - length_sums[first];
+    if (starts[first] < start)
+        idle -= start - starts[first];
+    if (ends[last - 1] > stop)
+        idle -= ends[last - 1] - stop;
+    return idle;
+}
+
+bool GapIndex::idleAt(unsigned long entity, unsigned long long time, Gap * gap) const
+{
+    std::vector<unsigned long long>::const_iterator first = starts.begin() + offsets[entity];
+    std::vector<unsigned long long>::const_iterator after
+        = std::upper_bound(first, starts.begin() + offsets[entity + 1], time);
+    if (after == first)
+        return false;
+
+    unsigned long g = (after - starts.begin()) - 1;
+    if (ends[g] <= time)
+        return false;
+    if (gap)
+        *gap = clipped(entity, g, starts[g], ends[g]);
+    return true;
+}
+
+// The gaps strictly inside the window are whole, so the longest of them
+// are taken out of runs one at a time, splitting the run around each
+void GapIndex::longest(unsigned long entity, unsigned long long start, unsigned long long stop,
+                       unsigned long k, std::vector<Gap>& heap) const
+{
+    if (start >= stop || k == 0)
+        return;
+
+    unsigned long first = std::upper_bound(ends.begin() + offsets[entity], ends.begin() + offsets[entity + 1],
+                                           start) - ends.begin();
+    unsigned long last = std::lower_bound(starts.begin() + offsets[entity], starts.begin() + offsets[entity + 1],
+                                          stop) - starts.begin();
+    if (first >= last)
+        return;
+
+    keep(heap, clipped(entity, first, start, stop), k);
+    if (last - 1 == first)
+        return;
+    keep(heap, clipped(entity, last - 1, start, stop), k);
+
+    struct Run {
+        unsigned long first;
+        unsigned long last;
+        unsigned long longest;
+    };
+    // Shorter longest gap first, then later, so the heap front is the
+    // earliest of the longest
+    struct RunShorter {
+        const std::vector<unsigned long long> * lengths;
+        bool operator()(const Run& r1, const Run& r2) const
+        {
+            if (lengths->at(r1.longest) != lengths->at(r2.longest))
+                return lengths->at(r1.longest) < lengths->at(r2.longest);
+            return r1.longest > r2.longest;
+        }
+    };
+    RunShorter shorter = { &lengths };
+    std::vector<Run> runs = std::vector<Run>();
+    if (first + 1 < last - 1)
+    {
+        Run run = { first + 1, last - 1, longestIn(entity, first + 1, last - 1) };
+        runs.push_back(run);
+    }
+    for (unsigned long taken = 0; taken < k && !runs.empty(); taken++)
+    {
+        std::pop_heap(runs.begin(), runs.end(), shorter);
+        Run run = runs.back();
+        runs.pop_back();
+
+        Gap gap = { starts[run.longest], lengths[run.longest], entity, lengths[run.longest] };
+        if (heap.size() >= k && !gapLongerThan(gap, heap.front()))
+            break;
+        keep(heap, gap, k);
+
+        if (run.first < run.longest)
+        {
+            Run before = { run.first, run.longest, longestIn(entity, run.first, run.longest) };
+            runs.push_back(before);
+            std::push_heap(runs.begin(), runs.end(), shorter);
+        }
+        if (run.longest + 1 < run.last)
+        {
+            Run after = { run.longest + 1, run.last, longestIn(entity, run.longest + 1, run.last) };
+            runs.push_back(after);
+            std::push_heap(runs.begin(), runs.end(), shorter);
+        }
+    }
+}
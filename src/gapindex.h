@@ -0,0 +1,94 @@
+#ifndef GAPINDEX_H
+#define GAPINDEX_H
+
+#include <vector>
+
+class Event;
+
+// Idle gaps of every entity, the times from start to stop not covered by
+// any of its root tasks. Each entity's gaps are kept in time order with
+// running sums of their lengths, so the idle time of a window and the gap
+// at a time take a binary search. The longest gap in a run is read from
+// a sparse table over blocks of gaps, so the longest k gaps of a window
+// need only the gaps of the blocks at the edges of each run looked at.
+class GapIndex
+{
+public:
+    GapIndex();
+
+    // Roots must be sorted by enter
+    void build(std::vector<std::vector<Event *> *> * roots,
+               unsigned long long _start, unsigned long long _stop);
+
+    struct Gap {
+        unsigned long long start;
+        unsigned long long length;
+        unsigned long entity;
+        unsigned long long inside; // Length within the window asked for
+    };
+
+    // Longer inside the window first, then by entity and start
+    static bool gapLongerThan(const Gap& g1, const Gap& g2)
+    {
+        if (g1.inside != g2.inside)
+            return g1.inside > g2.inside;
+        if (g1.entity != g2.entity)
+            return g1.entity < g2.entity;
+        return g1.start < g2.start;
+    }
+
+    struct Summary {
+        unsigned long long count;
+        unsigned long long total;
+        unsigned long long longest;
+    };
+
+    // Whole-trace gaps of an entity
+    Summary summary(unsigned long entity) const;
+
+    // Idle time of entity from start to stop
+    unsigned long long idleTime(unsigned long entity, unsigned long long start,
+                                unsigned long long stop) const;
+
+    // Whether entity is idle at time, and if so the gap it is in
+    bool idleAt(unsigned long entity, unsigned long long time, Gap * gap) const;
+
+    // Keep the k longest gaps in heap, whose front is the shortest kept
+    static void keep(std::vector<Gap>& heap, const Gap& gap, unsigned long k);
+    // Turn a heap into a list, longest first
+    static void finish(std::vector<Gap>& heap);
+
+    // Keep entity's gaps overlapping start to stop in heap
+    void longest(unsigned long entity, unsigned long long start, unsigned long long stop,
+                 unsigned long k, std::vector<Gap>& heap) const;
+
+    static const unsigned int block_size = 32;
+
+    unsigned long long start;
+    unsigned long long stop;
+
+private:
+    // Gap g of entity with its length within start to stop
+    Gap clipped(unsigned long entity, unsigned long g,
+                unsigned long long start, unsigned long long stop) const;
+    // The longest of entity's gaps from first up to last, the earliest of
+    // those tied
+    unsigned long longestIn(unsigned long entity, unsigned long first, unsigned long last) const;
+    unsigned long longerOf(unsigned long g1, unsigned long g2) const
+    {
+        return (lengths[g2] > lengths[g1]) ? g2 : g1;
+    }
+
+    std::vector<unsigned long> offsets; // Entity i's gaps from offsets[i]
+    std::vector<unsigned long long> starts;
+    std::vector<unsigned long long> ends;
+    std::vector<unsigned long long> lengths;
+    std::vector<unsigned long long> length_sums; // Of lengths before each gap
+    // Level l holds the longest gap of the 1 << l blocks from each block.
+    // Blocks are counted from each entity's first gap, and their runs
+    // never cross into the next entity.
+    std::vector<unsigned long> block_offsets; // Entity i's blocks from block_offsets[i]
+    std::vector<std::vector<unsigned long> > longest_table;
+};
+
+#endif // GAPINDEX_H
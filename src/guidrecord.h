@@ -1,8 +1,6 @@
 #ifndef GUIDRECORD_H
 #define GUIDRECORD_H
 
-class Message;
-
 // For message matching.
 class GUIDRecord
 {
@@ -17,7 +15,7 @@ public:
 
     bool matched;
 
-    Message * message;
+    long message; // Index into Trace::messages, -1 until created
 
     bool operator<(const  GUIDRecord &);
     bool operator>(const  GUIDRecord &);
@@ -0,0 +1,195 @@
+#include "histogramtree.h"
+#include "event.h"
+#include "metrics.h"
+#include "ravelutils.h"
+#include <algorithm>
+#include <cmath>
+
+HistogramTree::HistogramTree()
+    : start(0),
+      leaf_width(1),
+      leaves(1),
+      nodes(std::vector<std::vector<Entry> >())
+{
+}
+
+// Power of two and then the next bin_shift bits of the length
+unsigned int HistogramTree::bin(unsigned long long length)
+{
+    if (length == 0)
+        return 0;
+    unsigned int octave = 0;
+    while ((length >> octave) > 1)
+        octave++;
+    unsigned int step;
+    if (octave >= bin_shift)
+        step = (length >> (octave - bin_shift)) & (bin_steps - 1);
+    else
+        step = (length << (bin_shift - octave)) & (bin_steps - 1);
+    return 1 + octave * bin_steps + step;
+}
+
+double HistogramTree::binLength(unsigned int bin)
+{
+    if (bin == 0)
+        return 0;
+    unsigned int octave = (bin - 1) / bin_steps;
+    unsigned int step = (bin - 1) % bin_steps;
+    return ldexp(1.0 + (step + 0.5) / bin_steps, octave);
+}
+
+template <typename T, typename Less>
+void HistogramTree::merge(std::vector<T>& left, std::vector<T>& right,
+                          std::vector<T>& merged, Less less)
+{
+    merged.reserve(left.size() + right.size());
+    typename std::vector<T>::iterator l = left.begin(), r = right.begin();
+    while (l != left.end() || r != right.end())
+    {
+        if (r == right.end() || (l != left.end() && less(*l, *r)))
+        {
+            merged.push_back(*l++);
+        }
+        else if (l == left.end() || less(*r, *l))
+        {
+            merged.push_back(*r++);
+        }
+        else
+        {
+            merged.push_back(*l++);
+            countOf(merged.back()) += countOf(*r++);
+        }
+    }
+    merged.shrink_to_fit();
+}
+
+void HistogramTree::build(std::vector<std::vector<Event *> *> * events,
+                          unsigned long long _start, unsigned long long _stop, bool coalesced)
+{
+    start = _start;
+    unsigned long long span = (_stop > _start) ? _stop - _start : 0;
+    leaves = max_leaves;
+    while (leaves > 1 && leaves / 2 > span)
+        leaves /= 2;
+    leaf_width = span / leaves + 1;
+
+    // Each entity's counts by leaf, function and bin, sorted and summed
+    // while its events are at hand so only the distinct counts are kept
+    std::vector<std::vector<LeafEntry> > entity_entries(events->size());
+    RavelUtils::parallelFor(0, events->size(), [this, events, coalesced, &entity_entries](unsigned long entity) {
+        std::vector<LeafEntry> entries = std::vector<LeafEntry>();
+        entries.reserve(events->at(entity)->size());
+        for (std::vector<Event *>::iterator evt = events->at(entity)->begin();
+             evt != events->at(entity)->end(); ++evt)
+        {
+            unsigned long leaf = ((*evt)->enter > start) ? ((*evt)->enter - start) / leaf_width : 0;
+            LeafEntry entry = { std::min(leaf, leaves - 1),
+                                { (*evt)->function, bin((*evt)->exit - (*evt)->enter), 1 } };
+            if (coalesced && (*evt)->metrics->hasMetric("Coalesced Total"))
+            {
+                // The run's shortest and longest calls, and the rest at
+                // their mean length
+                unsigned long long calls = (*evt)->metrics->getMetric("Function Count");
+                unsigned long long total = (*evt)->metrics->getMetric("Coalesced Total");
+                unsigned long long shortest = (*evt)->metrics->getMetric("Coalesced Min");
+                unsigned long long longest = (*evt)->metrics->getMetric("Coalesced Max");
+                entry.entry.bin = bin(shortest);
+                entries.push_back(entry);
+                entry.entry.bin = bin(longest);
+                entries.push_back(entry);
+                if (calls <= 2)
+                    continue;
+                entry.entry.bin = bin((total - shortest - longest) / (calls - 2));
+                entry.entry.count = calls - 2;
+            }
+            entries.push_back(entry);
+        }
+        std::sort(entries.begin(), entries.end(), leafEntryLessThan);
+
+        std::vector<LeafEntry>& runs = entity_entries[entity];
+        for (std::vector<LeafEntry>::iterator entry = entries.begin();
+             entry != entries.end(); ++entry)
+        {
+            if (!runs.empty() && runs.back().leaf == entry->leaf
+                && runs.back().entry.function == entry->entry.function
+                && runs.back().entry.bin == entry->entry.bin)
+            {
+                runs.back().entry.count += entry->entry.count;
+            }
+            else
+            {
+                runs.push_back(*entry);
+            }
+        }
+        runs.shrink_to_fit();
+    });
+
+    // Merge the entities' lists pairwise, each round in parallel
+    for (unsigned long step = 1; step < entity_entries.size(); step *= 2)
+    {
+        RavelUtils::parallelFor(0, (entity_entries.size() + 2 * step - 1) / (2 * step),
+            [&entity_entries, step](unsigned long pair) {
+                unsigned long left = 2 * step * pair;
+                if (left + step >= entity_entries.size())
+                    return;
+                std::vector<LeafEntry> merged = std::vector<LeafEntry>();
+                merge(entity_entries[left], entity_entries[left + step], merged, leafEntryLessThan);
+                entity_entries[left].swap(merged);
+                std::vector<LeafEntry>().swap(entity_entries[left + step]);
+            });
+    }
+
+    nodes.assign(2 * leaves, std::vector<Entry>());
+    if (!entity_entries.empty())
+    {
+        std::vector<LeafEntry>& all_entries = entity_entries[0];
+        for (std::vector<LeafEntry>::iterator entry = all_entries.begin();
+             entry != all_entries.end(); ++entry)
+        {
+            nodes[leaves + entry->leaf].push_back(entry->entry);
+        }
+        std::vector<LeafEntry>().swap(all_entries);
+    }
+
+    // One level at a time from the leaves up, each level in parallel
+    for (unsigned long level = leaves / 2; level >= 1; level /= 2)
+    {
+        RavelUtils::parallelFor(level, 2 * level, [this](unsigned long n) {
+            merge(nodes[2 * n], nodes[2 * n + 1], nodes[n], entryLessThan);
+        });
+    }
+}
+
+void HistogramTree::window(unsigned long long start, unsigned long long stop,
+                           std::map<int, std::vector<unsigned long long> >& histograms) const
+{
+    if (stop <= start || stop <= this->start || nodes.empty())
+        return;
+
+    unsigned long first = (start > this->start) ? (start - this->start) / leaf_width : 0;
+    unsigned long last = (stop - 1 - this->start) / leaf_width + 1;
+    first = std::min(first, leaves);
+    last = std::min(last, leaves);
+
+    // Climb from both ends, taking each node that lies wholly inside
+    std::vector<unsigned long> covering = std::vector<unsigned long>();
+    for (unsigned long l = first + leaves, r = last + leaves; l < r; l /= 2, r /= 2)
+    {
+        if (l & 1)
+            covering.push_back(l++);
+        if (r & 1)
+            covering.push_back(--r);
+    }
+
+    for (std::vector<unsigned long>::iterator n = covering.begin(); n != covering.end(); ++n)
+    {
+        for (std::vector<Entry>::const_iterator entry = nodes[*n].begin();
+             entry != nodes[*n].end(); ++entry)
+        {
+            std::vector<unsigned long long>& histogram = histograms[entry->function];
+            if (histogram.empty())
+                histogram.assign(bins, 0);
+            histogram[entry->bin] += entry->count;
+        }
+    }
+}
@@ -0,0 +1,80 @@
+#ifndef HISTOGRAMTREE_H
+#define HISTOGRAMTREE_H
+
+#include <map>
+#include <vector>
+
+class Event;
+
+// Task length histograms per function for any time window. Lengths go
+// into log bins, bin_steps to each power of two, each event under the leaf
+// holding its enter. Leaves evenly split the trace and each node of the
+// segment tree above them merges its children's sparse histograms, so a
+// window reads O(log leaves) nodes. Windows are widened to whole leaves.
+// An event standing in for coalesced calls counts as those calls, so the
+// counts agree with the whole-trace task lengths.
+class HistogramTree
+{
+public:
+    HistogramTree();
+
+    // Coalesced tells whether events may stand in for runs of calls
+    void build(std::vector<std::vector<Event *> *> * events,
+               unsigned long long _start, unsigned long long _stop, bool coalesced);
+
+    // Add the counts of events entering in start to stop to histograms,
+    // by function and then bin
+    void window(unsigned long long start, unsigned long long stop,
+                std::map<int, std::vector<unsigned long long> >& histograms) const;
+
+    static unsigned int bin(unsigned long long length);
+    // Middle of the lengths in a bin
+    static double binLength(unsigned int bin);
+
+    static const unsigned int bin_shift = 4;
+    static const unsigned int bin_steps = 1 << bin_shift;
+    static const unsigned int bins = 1 + 64 * bin_steps; // Bin 0 is length 0
+    static const unsigned long max_leaves = 4096;
+
+    unsigned long long start;
+    unsigned long long leaf_width;
+    unsigned long leaves; // A power of two
+
+private:
+    struct Entry {
+        int function;
+        unsigned int bin;
+        unsigned long long count;
+    };
+    static bool entryLessThan(const Entry& e1, const Entry& e2)
+    {
+        if (e1.function != e2.function)
+            return e1.function < e2.function;
+        return e1.bin < e2.bin;
+    }
+
+    // Counts of one leaf while building
+    struct LeafEntry {
+        unsigned long leaf;
+        Entry entry;
+    };
+    static bool leafEntryLessThan(const LeafEntry& e1, const LeafEntry& e2)
+    {
+        if (e1.leaf != e2.leaf)
+            return e1.leaf < e2.leaf;
+        return entryLessThan(e1.entry, e2.entry);
+    }
+    static unsigned long long& countOf(Entry& entry) { return entry.count; }
+    static unsigned long long& countOf(LeafEntry& entry) { return entry.entry.count; }
+
+    // Merge two sorted lists, adding the counts of equal entries
+    template <typename T, typename Less>
+    static void merge(std::vector<T>& left, std::vector<T>& right,
+                      std::vector<T>& merged, Less less);
+
+    // Node 1 is the root and node i has children 2i and 2i + 1, with
+    // leaves from node leaves on
+    std::vector<std::vector<Entry> > nodes;
+};
+
+#endif // HISTOGRAMTREE_H
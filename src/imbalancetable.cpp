@@ -0,0 +1,81 @@
+#include "imbalancetable.h"
+#include "event.h"
+#include "busyprofile.h"
+#include "ravelutils.h"
+#include <algorithm>
+#include <cmath>
+
+ImbalanceTable::ImbalanceTable(unsigned long long _start, unsigned long long _bin_width,
+                               unsigned long _bins)
+    : start(_start),
+      bin_width(_bin_width),
+      bins(_bins),
+      entities(0),
+      cumulative(std::vector<uint32_t>())
+{
+}
+
+void ImbalanceTable::build(std::vector<std::vector<Event *> *> * roots)
+{
+    entities = roots->size();
+    cumulative.assign(entities * (bins + 1), 0);
+    RavelUtils::parallelFor(0, entities, [this, roots](unsigned long entity) {
+        BusyProfile busy(start, bin_width, bins);
+        unsigned long long covered = 0;
+        std::vector<Event *> * entity_roots = roots->at(entity);
+        for (std::vector<Event *>::iterator root = entity_roots->begin();
+             root != entity_roots->end(); ++root)
+        {
+            unsigned long long enter = std::max(covered, (*root)->enter);
+            if ((*root)->exit > enter)
+                busy.add(enter, (*root)->exit);
+            covered = std::max(covered, (*root)->exit);
+        }
+        busy.finish();
+
+        uint32_t * totals = &cumulative[entity * (bins + 1)];
+        double before = 0;
+        for (unsigned long bin = 0; bin < bins; bin++)
+        {
+            double after = busy.busyBefore(start + (bin + 1) * static_cast<double>(bin_width));
+            totals[bin + 1] = totals[bin]
+                              + static_cast<uint32_t>(round(scale * (after - before) / bin_width));
+            before = after;
+        }
+    });
+}
+
+double ImbalanceTable::busyBefore(unsigned long entity, double offset) const
+{
+    const uint32_t * totals = &cumulative[entity * (bins + 1)];
+    if (offset <= 0)
+        return 0;
+    unsigned long bin = static_cast<unsigned long>(offset);
+    if (bin >= bins)
+        return totals[bins];
+    return totals[bin] + (offset - bin) * (totals[bin + 1] - totals[bin]);
+}
+
+ImbalanceTable::Spread ImbalanceTable::spread(double from, double to) const
+{
+    Spread result = { 0, 0, 0, 0 };
+    double first = (from - start) / bin_width;
+    double last = (to - start) / bin_width;
+    if (entities == 0 || last <= first)
+        return result;
+
+    double sum = 0, squares = 0;
+    result.min = 1;
+    for (unsigned long entity = 0; entity < entities; entity++)
+    {
+        double fraction = (busyBefore(entity, last) - busyBefore(entity, first))
+                          / (scale * (last - first));
+        result.max = std::max(result.max, fraction);
+        result.min = std::min(result.min, fraction);
+        sum += fraction;
+        squares += fraction * fraction;
+    }
+    result.mean = sum / entities;
+    result.stddev = sqrt(std::max(0.0, squares / entities - result.mean * result.mean));
+    return result;
+}
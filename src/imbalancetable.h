@@ -0,0 +1,45 @@
+#ifndef IMBALANCETABLE_H
+#define IMBALANCETABLE_H
+
+#include <vector>
+#include <stdint.h>
+
+class Event;
+
+// Busy fraction of every entity over fixed width bins from start, kept
+// as running totals of fixed point fractions so the spread across
+// entities over any interval takes two lookups per entity. Busy time is
+// the time covered by an entity's call trees.
+class ImbalanceTable
+{
+public:
+    ImbalanceTable(unsigned long long _start, unsigned long long _bin_width,
+                   unsigned long _bins);
+
+    // Entities are filled in parallel, roots sorted by enter
+    void build(std::vector<std::vector<Event *> *> * roots);
+
+    struct Spread {
+        double max;
+        double min;
+        double mean;
+        double stddev;
+    };
+
+    // Busy fractions across entities between two times
+    Spread spread(double from, double to) const;
+
+    unsigned long long start;
+    unsigned long long bin_width;
+    unsigned long bins;
+
+    static const uint32_t scale = 65535; // A wholly busy bin
+
+private:
+    double busyBefore(unsigned long entity, double offset) const;
+
+    unsigned long entities;
+    std::vector<uint32_t> cumulative; // bins + 1 per entity
+};
+
+#endif // IMBALANCETABLE_H
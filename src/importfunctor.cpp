@@ -11,13 +11,14 @@ ImportFunctor::ImportFunctor()
 {
 }
 
-Trace * ImportFunctor::doImportOTF2(std::string dataFileName, bool logging)
+Trace * ImportFunctor::doImportOTF2(std::string dataFileName,
+                                    OTFImportOptions * options, bool logging)
 {
     std::cout << "Processing " << dataFileName.c_str() << std::endl;
     clock_t start = clock();
 
     OTFConverter * importer = new OTFConverter();
-    Trace* trace = importer->importOTF2(dataFileName, logging);
+    Trace* trace = importer->importOTF2(dataFileName, options, logging);
     delete importer;
 
     if (trace)
@@ -32,7 +33,8 @@ Trace * ImportFunctor::doImportOTF2(std::string dataFileName, bool logging)
     return trace;
 }
 
-Trace *ImportFunctor::doImportOTF(std::string dataFileName, bool logging)
+Trace *ImportFunctor::doImportOTF(std::string dataFileName,
+                                  OTFImportOptions * options, bool logging)
 {
     #ifdef OTF1LIB
     std::cout << "Processing " << dataFileName.c_str() << std::endl;
@@ -40,7 +42,7 @@ Trace *ImportFunctor::doImportOTF(std::string dataFileName, bool logging)
 
 
     OTFConverter * importer = new OTFConverter();
-    Trace* trace = importer->importOTF(dataFileName, logging);
+    Trace* trace = importer->importOTF(dataFileName, options, logging);
     delete importer;
 
     if (trace)
@@ -4,6 +4,7 @@
 #include <string>
 
 class Trace;
+class OTFImportOptions;
 
 // Handle signaling for progress bar
 class ImportFunctor
@@ -12,8 +13,10 @@ public:
     ImportFunctor();
     Trace * getTrace() { return trace; }
 
-    Trace * doImportOTF(std::string dataFileName, bool logging);
-    Trace *doImportOTF2(std::string dataFileName, bool logging);
+    Trace * doImportOTF(std::string dataFileName, OTFImportOptions * options,
+                        bool logging);
+    Trace *doImportOTF2(std::string dataFileName, OTFImportOptions * options,
+                        bool logging);
 
 private:
     Trace * trace;
@@ -0,0 +1,7 @@
+#include "importoptions.h"
+
+OTFImportOptions::OTFImportOptions()
+    : coalesceSpan(0),
+      rankBySelfTime(false)
+{
+}
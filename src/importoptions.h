@@ -0,0 +1,14 @@
+#ifndef IMPORTOPTIONS_H
+#define IMPORTOPTIONS_H
+
+// Choices made when a trace is loaded, set from the command line
+class OTFImportOptions
+{
+public:
+    OTFImportOptions();
+
+    unsigned long long coalesceSpan; // Merge repeated calls this short, 0 is off
+    bool rankBySelfTime; // Rank functions by self time rather than call count
+};
+
+#endif // IMPORTOPTIONS_H
@@ -0,0 +1,146 @@
+#include "lodpyramid.h"
+#include "event.h"
+#include <algorithm>
+
+// Time one event adds to one bucket, sorted so that a bucket's entries
+// are adjacent and grouped by function
+struct BucketShare
+{
+    int depth;
+    unsigned long long index;
+    int function;
+    unsigned long long busy;
+    unsigned long count;
+
+    bool operator<(const BucketShare& other) const
+    {
+        if (depth != other.depth)
+            return depth < other.depth;
+        if (index != other.index)
+            return index < other.index;
+        return function < other.function;
+    }
+};
+
+// Sum the shares of each bucket into the depth's list, keeping the
+// function with the most time
+static void reduceShares(std::vector<BucketShare>& shares,
+                         std::vector<std::vector<LODPyramid::Bucket> >& depths)
+{
+    std::sort(shares.begin(), shares.end());
+
+    std::vector<BucketShare>::iterator share = shares.begin();
+    while (share != shares.end())
+    {
+        LODPyramid::Bucket bucket;
+        bucket.index = share->index;
+        bucket.busy = 0;
+        bucket.count = 0;
+        bucket.function = share->function;
+        unsigned long long function_busy = 0;
+        int depth = share->depth;
+        while (share != shares.end() && share->depth == depth
+               && share->index == bucket.index)
+        {
+            int function = share->function;
+            unsigned long long busy = 0;
+            for (; share != shares.end() && share->depth == depth
+                   && share->index == bucket.index && share->function == function;
+                 ++share)
+            {
+                busy += share->busy;
+                bucket.count += share->count;
+            }
+            bucket.busy += busy;
+            if (busy > function_busy)
+            {
+                function_busy = busy;
+                bucket.function = function;
+            }
+        }
+        depths[depth].push_back(bucket);
+    }
+
+    for (std::vector<std::vector<LODPyramid::Bucket> >::iterator depth = depths.begin();
+         depth != depths.end(); ++depth)
+    {
+        depth->shrink_to_fit();
+    }
+}
+
+LODPyramid::LODPyramid(unsigned long long _origin, int _finest_shift, int _levels)
+    : origin(_origin),
+      finest_shift(_finest_shift),
+      levels(std::vector<std::vector<std::vector<Bucket> > >(_levels))
+{
+}
+
+void LODPyramid::build(std::vector<Event *> * events, int max_depth)
+{
+    for (unsigned long level = 0; level < levels.size(); level++)
+    {
+        levels[level].resize(max_depth + 1);
+        buildLevel(events, level);
+    }
+}
+
+void LODPyramid::buildLevel(std::vector<Event *> * events, int level)
+{
+    int shift = finest_shift + level;
+    unsigned long long width = bucketWidth(level);
+    std::vector<BucketShare> shares = std::vector<BucketShare>();
+    for (std::vector<Event *>::iterator evt = events->begin();
+         evt != events->end(); ++evt)
+    {
+        Event * e = *evt;
+        if (e->depth < 0 || e->depth >= depths() || e->enter < origin
+            || e->exit - e->enter > width)
+        {
+            continue;
+        }
+
+        // No longer than a bucket, so it touches at most two
+        BucketShare share;
+        share.depth = e->depth;
+        share.function = e->function;
+        share.index = (e->enter - origin) >> shift;
+        unsigned long long boundary = origin + ((share.index + 1) << shift);
+        share.busy = std::min(e->exit, boundary) - e->enter;
+        share.count = 1;
+        shares.push_back(share);
+        if (e->exit > boundary)
+        {
+            share.index++;
+            share.busy = e->exit - boundary;
+            share.count = 0;
+            shares.push_back(share);
+        }
+    }
+    reduceShares(shares, levels[level]);
+}
+
+unsigned long LODPyramid::lowerBound(const std::vector<Bucket>& buckets,
+                                     unsigned long long index)
+{
+    unsigned long low = 0, high = buckets.size();
+    while (low < high)
+    {
+        unsigned long mid = low + (high - low) / 2;
+        if (buckets[mid].index < index)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+    return low;
+}
+
+int LODPyramid::levelFor(unsigned long long span, int finest_shift, int levels)
+{
+    if (levels == 0 || span < (1ULL << finest_shift))
+        return -1;
+
+    int level = 0;
+    while (level + 1 < levels && (1ULL << (finest_shift + level + 1)) <= span)
+        level++;
+    return level;
+}
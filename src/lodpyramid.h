@@ -0,0 +1,55 @@
+#ifndef LODPYRAMID_H
+#define LODPYRAMID_H
+
+#include <vector>
+
+class Event;
+
+// Level-of-detail summary of one entity's timeline. Level l cuts time into
+// buckets of 1 << (finest_shift + l) ticks starting at origin and, for
+// each depth, aggregates the events no longer than a bucket: the time
+// they cover in the bucket, how many enter in it and which function
+// covers the most. Those are exactly the events a window query drops when
+// its minimum span is one bucket, so a zoomed out view can show them as
+// density instead of empty space.
+class LODPyramid
+{
+public:
+    LODPyramid(unsigned long long _origin, int _finest_shift, int _levels);
+
+    void build(std::vector<Event *> * events, int max_depth);
+
+    struct Bucket {
+        unsigned long long index; // Bucket number at its level from origin
+        unsigned long long busy; // Time covered by aggregated events
+        unsigned long count; // Aggregated events entering in this bucket
+        int function; // Function covering the most time
+    };
+
+    // Non-empty buckets at a level and depth, sorted by index
+    const std::vector<Bucket>& buckets(int level, int depth) const
+    {
+        return levels[level][depth];
+    }
+    int depths() const { return levels.empty() ? 0 : levels[0].size(); }
+
+    // Position of the first bucket at or after index
+    static unsigned long lowerBound(const std::vector<Bucket>& buckets,
+                                    unsigned long long index);
+
+    unsigned long long bucketWidth(int level) const { return 1ULL << (finest_shift + level); }
+
+    // Coarsest level whose buckets are no wider than span, -1 if even the
+    // finest buckets are wider
+    static int levelFor(unsigned long long span, int finest_shift, int levels);
+
+    unsigned long long origin;
+    int finest_shift;
+
+private:
+    void buildLevel(std::vector<Event *> * events, int level);
+
+    std::vector<std::vector<std::vector<Bucket> > > levels; // By level, then depth
+};
+
+#endif // LODPYRAMID_H
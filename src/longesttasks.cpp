@@ -0,0 +1,242 @@
+#include "longesttasks.h"
+#include "event.h"
+#include "metrics.h"
+#include "ravelutils.h"
+#include <algorithm>
+
+LongestTasks::LongestTasks()
+    : rank_by(-1),
+      blocks(std::vector<Block>()),
+      summaries(std::vector<unsigned long>())
+{
+}
+
+unsigned long long LongestTasks::length(Event * evt, int rank_by)
+{
+    if (rank_by >= 0)
+    {
+        for (std::vector<Metrics::MetricValue, ArenaAllocator<Metrics::MetricValue> >::iterator metric
+             = evt->metrics->metrics.begin(); metric != evt->metrics->metrics.end(); ++metric)
+        {
+            if (metric->first == rank_by)
+                return static_cast<unsigned long long>(metric->second);
+        }
+    }
+    return evt->exit - evt->enter;
+}
+
+void LongestTasks::keep(std::vector<Task>& heap, const Task& task, unsigned long k)
+{
+    if (heap.size() < k)
+    {
+        heap.push_back(task);
+        std::push_heap(heap.begin(), heap.end(), taskLongerThan);
+    }
+    else if (k > 0 && taskLongerThan(task, heap.front()))
+    {
+        std::pop_heap(heap.begin(), heap.end(), taskLongerThan);
+        heap.back() = task;
+        std::push_heap(heap.begin(), heap.end(), taskLongerThan);
+    }
+}
+
+void LongestTasks::finish(std::vector<Task>& heap)
+{
+    std::sort_heap(heap.begin(), heap.end(), taskLongerThan);
+}
+
+template <typename At>
+void LongestTasks::summarize(At at, Block& block, std::vector<Task>& heap)
+{
+    Event * evt = at(block.first);
+    block.min_enter = evt->enter;
+    block.max_enter = evt->enter;
+    block.min_exit = evt->exit;
+    block.max_exit = evt->exit;
+
+    heap.clear();
+    for (unsigned long position = block.first; position < block.last; position++)
+    {
+        evt = at(position);
+        block.min_enter = std::min(block.min_enter, evt->enter);
+        block.max_enter = std::max(block.max_enter, evt->enter);
+        block.min_exit = std::min(block.min_exit, evt->exit);
+        block.max_exit = std::max(block.max_exit, evt->exit);
+        Task task = { length(evt, rank_by), 0, position };
+        keep(heap, task, summary_size);
+    }
+    finish(heap);
+
+    block.summary_count = heap.size();
+    for (unsigned int s = 0; s < block.summary_count; s++)
+        summaries[block.summary + s] = heap[s].index;
+}
+
+void LongestTasks::build(std::vector<Event *> * events, int _rank_by)
+{
+    rank_by = _rank_by;
+    blocks.clear();
+    summaries.assign(0, 0);
+
+    std::vector<Task> heap = std::vector<Task>();
+    for (unsigned long first = 0; first < events->size(); first += block_size)
+    {
+        Block block;
+        block.first = first;
+        block.last = std::min(first + block_size, static_cast<unsigned long>(events->size()));
+        block.summary = summaries.size();
+        summaries.resize(block.summary + std::min(block.last - first,
+                                                  static_cast<unsigned long>(summary_size)));
+        summarize([events](unsigned long position) { return events->at(position); },
+                  block, heap);
+
+        block.prefix_max_exit = block.max_exit;
+        if (!blocks.empty())
+            block.prefix_max_exit = std::max(block.max_exit, blocks.back().prefix_max_exit);
+        blocks.push_back(block);
+    }
+    summaries.shrink_to_fit();
+    blocks.shrink_to_fit();
+}
+
+// Every block's place and summary slots are known from the run lengths,
+// so the runs are summarized in parallel
+void LongestTasks::build(const OccurrenceIndex * occurrences,
+                         std::vector<std::vector<Event *> *> * events, int _rank_by)
+{
+    rank_by = _rank_by;
+    const std::vector<OccurrenceIndex::Run>& runs = occurrences->allRuns();
+    std::vector<unsigned long> run_blocks(runs.size() + 1, 0);
+    blocks.clear();
+    unsigned long summary = 0;
+    for (unsigned long r = 0; r < runs.size(); r++)
+    {
+        for (unsigned long first = runs[r].begin; first < runs[r].end; first += block_size)
+        {
+            Block block;
+            block.first = first;
+            block.last = std::min(first + block_size, runs[r].end);
+            block.summary = summary;
+            summary += std::min(block.last - first, static_cast<unsigned long>(summary_size));
+            blocks.push_back(block);
+        }
+        run_blocks[r + 1] = blocks.size();
+    }
+    summaries.assign(summary, 0);
+
+    RavelUtils::parallelFor(0, runs.size(), [this, occurrences, events, &runs, &run_blocks](unsigned long r) {
+        std::vector<Event *> * entity_events = events->at(runs[r].entity);
+        std::vector<Task> heap = std::vector<Task>();
+        for (unsigned long b = run_blocks[r]; b < run_blocks[r + 1]; b++)
+        {
+            summarize([occurrences, entity_events](unsigned long position) {
+                          return entity_events->at(occurrences->indices[position]);
+                      },
+                      blocks[b], heap);
+            blocks[b].prefix_max_exit = blocks[b].max_exit;
+            if (b > run_blocks[r])
+                blocks[b].prefix_max_exit = std::max(blocks[b].max_exit, blocks[b - 1].prefix_max_exit);
+        }
+    });
+}
+
+void LongestTasks::window(unsigned long entity, std::vector<Event *> * events,
+                          unsigned long long start, unsigned long long stop,
+                          unsigned long k, std::vector<Task>& heap) const
+{
+    // Blocks before the first whose running maximum exit passes start
+    // have nothing in the window
+    unsigned long low = 0, high = blocks.size();
+    while (low < high)
+    {
+        unsigned long mid = low + (high - low) / 2;
+        if (blocks[mid].prefix_max_exit > start)
+            high = mid;
+        else
+            low = mid + 1;
+    }
+
+    for (unsigned long b = low; b < blocks.size(); b++)
+    {
+        const Block& block = blocks[b];
+        if (block.min_enter >= stop || block.max_exit <= start)
+            continue;
+
+        // Whole block in the window, so its longest are the summary
+        if (k <= summary_size && block.max_enter < stop && block.min_exit > start)
+        {
+            for (unsigned int s = 0; s < block.summary_count; s++)
+            {
+                unsigned long index = summaries[block.summary + s];
+                Task task = { length(events->at(index), rank_by), entity, index };
+                keep(heap, task, k);
+            }
+            continue;
+        }
+
+        for (unsigned long index = block.first; index < block.last; index++)
+        {
+            Event * evt = events->at(index);
+            if (evt->enter < stop && evt->exit > start)
+            {
+                Task task = { length(evt, rank_by), entity, index };
+                keep(heap, task, k);
+            }
+        }
+    }
+}
+
+// The run's calls from the first still running at start up to the first
+// entering at stop all enter before stop, so only the blocks at the ends
+// of that stretch, or holding calls done by start, are looked into
+void LongestTasks::window(const OccurrenceIndex::Run& run, const OccurrenceIndex * occurrences,
+                          std::vector<std::vector<Event *> *> * events,
+                          unsigned long long start, unsigned long long stop,
+                          unsigned long k, std::vector<Task>& heap) const
+{
+    unsigned long begin = occurrences->firstActiveAt(run, start);
+    unsigned long end = occurrences->firstFrom(run, stop);
+    if (begin >= end)
+        return;
+
+    unsigned long low = 0, high = blocks.size();
+    while (low < high)
+    {
+        unsigned long mid = low + (high - low) / 2;
+        if (blocks[mid].last > begin)
+            high = mid;
+        else
+            low = mid + 1;
+    }
+
+    std::vector<Event *> * entity_events = events->at(run.entity);
+    for (unsigned long b = low; b < blocks.size() && blocks[b].first < end; b++)
+    {
+        const Block& block = blocks[b];
+        if (block.max_exit <= start)
+            continue;
+
+        if (k <= summary_size && block.first >= begin && block.last <= end && block.min_exit > start)
+        {
+            for (unsigned int s = 0; s < block.summary_count; s++)
+            {
+                unsigned long index = occurrences->indices[summaries[block.summary + s]];
+                Task task = { length(entity_events->at(index), rank_by), run.entity, index };
+                keep(heap, task, k);
+            }
+            continue;
+        }
+
+        for (unsigned long position = std::max(block.first, begin);
+             position < std::min(block.last, end); position++)
+        {
+            unsigned long index = occurrences->indices[position];
+            Event * evt = entity_events->at(index);
+            if (evt->exit > start)
+            {
+                Task task = { length(evt, rank_by), run.entity, index };
+                keep(heap, task, k);
+            }
+        }
+    }
+}
@@ -0,0 +1,95 @@
+#ifndef LONGESTTASKS_H
+#define LONGESTTASKS_H
+
+#include <vector>
+#include "occurrenceindex.h"
+
+class Event;
+
+// Longest tasks for any time window. Events are cut into blocks, each
+// with its time bounds and its summary_size longest events, so a window
+// only has to look at the events of blocks straddling its edges and reads
+// the rest from the summaries. Blocks either follow one entity's events
+// in their stored order, or each function's calls on each entity in the
+// order of the occurrence index, never crossing from one run into the
+// next.
+//
+// A task ranks by its length, except that an event standing in for a run
+// of coalesced calls ranks by the longest of them rather than the span of
+// the whole run.
+class LongestTasks
+{
+public:
+    LongestTasks();
+
+    // Over one entity's events, ranking coalesced runs by metric rank_by
+    // if it is not negative
+    void build(std::vector<Event *> * events, int rank_by);
+    // Over every run of the occurrence index
+    void build(const OccurrenceIndex * occurrences,
+               std::vector<std::vector<Event *> *> * events, int rank_by);
+
+    struct Task {
+        unsigned long long length;
+        unsigned long entity;
+        unsigned long index;
+    };
+
+    // Longer first, then by entity and index so ties are stable
+    static bool taskLongerThan(const Task& t1, const Task& t2)
+    {
+        if (t1.length != t2.length)
+            return t1.length > t2.length;
+        if (t1.entity != t2.entity)
+            return t1.entity < t2.entity;
+        return t1.index < t2.index;
+    }
+
+    // Length evt ranks by
+    static unsigned long long length(Event * evt, int rank_by);
+
+    // Keep the k longest tasks in heap, whose front is the shortest kept
+    static void keep(std::vector<Task>& heap, const Task& task, unsigned long k);
+    // Turn a heap into a list, longest first
+    static void finish(std::vector<Task>& heap);
+
+    // Keep the events overlapping start to stop in heap, when built over
+    // this entity's events
+    void window(unsigned long entity, std::vector<Event *> * events,
+                unsigned long long start, unsigned long long stop,
+                unsigned long k, std::vector<Task>& heap) const;
+    // Keep the calls of one run overlapping start to stop in heap, when
+    // built over the occurrence index
+    void window(const OccurrenceIndex::Run& run, const OccurrenceIndex * occurrences,
+                std::vector<std::vector<Event *> *> * events,
+                unsigned long long start, unsigned long long stop,
+                unsigned long k, std::vector<Task>& heap) const;
+
+    static const unsigned int block_size = 256;
+    static const unsigned int summary_size = 32; // Largest k served from summaries
+
+private:
+    struct Block {
+        unsigned long first; // Positions first up to last
+        unsigned long last;
+        unsigned long long min_enter;
+        unsigned long long max_enter;
+        unsigned long long min_exit;
+        unsigned long long max_exit;
+        unsigned long long prefix_max_exit; // Over this and earlier blocks of the entity
+        unsigned long summary; // First of the block's entries in summaries
+        unsigned int summary_count;
+    };
+
+    // Bounds and longest events of positions first up to last, the
+    // summary written from block.summary. Event at(position) resolves a
+    // position.
+    template <typename At>
+    void summarize(At at, Block& block, std::vector<Task>& heap);
+
+    int rank_by;
+    std::vector<Block> blocks;
+    std::vector<unsigned long> summaries; // Positions, longest first
+};
+
+#endif // LONGESTTASKS_H
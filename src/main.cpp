@@ -4,6 +4,7 @@
  */
 
 #include <cstdlib>
+#include <climits>
 #include <string>
 #include <cstring>
 #include <map>
@@ -12,6 +13,8 @@
 #include <sstream>
 #include "trace.h"
 #include "importfunctor.h"
+#include "importoptions.h"
+#include "stringpool.h"
 #include <cstdio>
 #include "external/mongoose.h"
 #include <nlohmann/json.hpp>
@@ -27,6 +30,7 @@ bool logging = false;
 bool extended_tips = false;
 bool server_logging = false;
 bool trace_set = false;
+OTFImportOptions import_options;
 
 static void handle_data_call(struct mg_connection *nc, struct http_message *hm) {
   const std::string sep = "\r\n";
@@ -54,6 +58,7 @@ static void handle_data_call(struct mg_connection *nc, struct http_message *hm)
     std::string start, stop, entity_start, entities, task,
                 task_time, focus_type, hover;
     long width;
+    unsigned long rows = 0;
     start = j["start"];
     stop = j["stop"];
     entity_start = j["entity_start"];
@@ -63,6 +68,8 @@ static void handle_data_call(struct mg_connection *nc, struct http_message *hm)
     task_time = j["focus_time"];
     focus_type = j["focus_type"];
     hover = j["hover_task"];
+    if (j.count("rows"))
+      rows = j["rows"];
     
     if (logging || server_logging) {
       std::cout << "Request for start/stop (" << start << ", " << stop << ") and ";
@@ -76,6 +83,7 @@ static void handle_data_call(struct mg_connection *nc, struct http_message *hm)
                                        std::stoull(entity_start.c_str()),
                                        std::stoull(entities.c_str()),
                                        width,
+                                       rows,
                                        std::stoull(task.c_str()),
                                        std::stoull(task_time.c_str()),
                                        std::stoul(focus_type.c_str()),
@@ -106,11 +114,196 @@ static void handle_data_call(struct mg_connection *nc, struct http_message *hm)
       std::cout << "overview called." << std::endl;
     }
   }
+  else if (cmd.compare("imbalance") == 0)
+  {
+    unsigned long width;
+    width = j["width"];
+    j["traceinfo"] = trace->imbalanceOverview(width, logging);
+  }
+  else if (cmd.compare("hierarchy") == 0)
+  {
+    long node = -1;
+    if (j.count("node"))
+      node = j["node"];
+    j["traceinfo"] = trace->hierarchyJSON(node, logging);
+  }
+  else if (cmd.compare("task") == 0)
+  {
+    std::string guid = j["guid"];
+    j["traceinfo"] = trace->taskJSON(std::stoull(guid.c_str()), logging);
+  }
+  else if (cmd.compare("function_events") == 0)
+  {
+    unsigned long long start, stop, entity_start, entities;
+    unsigned long width;
+    int function;
+    function = j["function"];
+    start = j["start"];
+    stop = j["stop"];
+    entity_start = j["entity_start"];
+    entities = j["entities"];
+    width = j["width"];
+    j["traceinfo"] = trace->functionEventsJSON(function, start, stop, entity_start,
+                                               entities, width, logging);
+  }
+  else if (cmd.compare("occurrence") == 0)
+  {
+    long entity = -1;
+    unsigned long long time = 0;
+    unsigned long n = 0;
+    int function = j["function"];
+    std::string which = j["which"];
+    if (j.count("entity"))
+      entity = j["entity"];
+    if (j.count("time"))
+      time = j["time"];
+    if (j.count("n"))
+      n = j["n"];
+    j["traceinfo"] = trace->occurrenceJSON(function, entity, time, which, n, logging);
+  }
+  else if (cmd.compare("search") == 0)
+  {
+    Trace::SearchFilter filter;
+    if (j.count("function_pattern"))
+      filter.function_pattern = j["function_pattern"];
+    if (j.count("start"))
+      filter.start = j["start"];
+    if (j.count("stop"))
+      filter.stop = j["stop"];
+    if (j.count("min_duration"))
+      filter.min_duration = j["min_duration"];
+    if (j.count("max_duration"))
+      filter.max_duration = j["max_duration"];
+    if (j.count("entity_start"))
+      filter.entity_start = j["entity_start"];
+    if (j.count("entities"))
+      filter.entities = j["entities"];
+    if (j.count("min_depth"))
+      filter.min_depth = j["min_depth"];
+    if (j.count("max_depth"))
+      filter.max_depth = j["max_depth"];
+    if (j.count("offset"))
+      filter.offset = j["offset"];
+    if (j.count("limit"))
+      filter.limit = j["limit"];
+    j["traceinfo"] = trace->searchJSON(filter, logging);
+  }
+  else if (cmd.compare("longest") == 0)
+  {
+    int function = -1;
+    unsigned long long start = 0, stop = ULLONG_MAX;
+    unsigned long k = 10;
+    if (j.count("function"))
+      function = j["function"];
+    if (j.count("start"))
+      start = j["start"];
+    if (j.count("stop"))
+      stop = j["stop"];
+    if (j.count("k"))
+      k = j["k"];
+    j["traceinfo"] = trace->longestJSON(function, start, stop, k, logging);
+  }
+  else if (cmd.compare("profile") == 0)
+  {
+    unsigned long long start = 0, stop = ULLONG_MAX;
+    unsigned long long entity_start = 0, entities = ULLONG_MAX;
+    if (j.count("start"))
+      start = j["start"];
+    if (j.count("stop"))
+      stop = j["stop"];
+    if (j.count("entity_start"))
+      entity_start = j["entity_start"];
+    if (j.count("entities"))
+      entities = j["entities"];
+    j["traceinfo"] = trace->profileJSON(start, stop, entity_start, entities, logging);
+  }
+  else if (cmd.compare("flamegraph") == 0)
+  {
+    unsigned long long start = 0, stop = ULLONG_MAX;
+    unsigned long long entity_start = 0, entities = ULLONG_MAX;
+    if (j.count("start"))
+      start = j["start"];
+    if (j.count("stop"))
+      stop = j["stop"];
+    if (j.count("entity_start"))
+      entity_start = j["entity_start"];
+    if (j.count("entities"))
+      entities = j["entities"];
+    j["traceinfo"] = trace->flameGraphJSON(start, stop, entity_start, entities, logging);
+  }
+  else if (cmd.compare("message_stats") == 0)
+  {
+    unsigned long long start = 0, stop = ULLONG_MAX;
+    unsigned long long entity_start = 0, entities = ULLONG_MAX;
+    std::string side = "send";
+    unsigned long limit = 100;
+    if (j.count("start"))
+      start = j["start"];
+    if (j.count("stop"))
+      stop = j["stop"];
+    if (j.count("entity_start"))
+      entity_start = j["entity_start"];
+    if (j.count("entities"))
+      entities = j["entities"];
+    if (j.count("side"))
+      side = j["side"];
+    if (j.count("limit"))
+      limit = j["limit"];
+    j["traceinfo"] = trace->messageStatsJSON(start, stop, entity_start, entities,
+                                             side.compare("receive") == 0, limit, logging);
+  }
+  else if (cmd.compare("idle_gaps") == 0)
+  {
+    unsigned long long start = 0, stop = ULLONG_MAX;
+    unsigned long long entity_start = 0, entities = ULLONG_MAX;
+    unsigned long k = 10;
+    if (j.count("start"))
+      start = j["start"];
+    if (j.count("stop"))
+      stop = j["stop"];
+    if (j.count("entity_start"))
+      entity_start = j["entity_start"];
+    if (j.count("entities"))
+      entities = j["entities"];
+    if (j.count("k"))
+      k = j["k"];
+    j["traceinfo"] = trace->idleGapsJSON(start, stop, entity_start, entities, k, logging);
+  }
+  else if (cmd.compare("idle_fraction") == 0)
+  {
+    unsigned long long start = 0, stop = ULLONG_MAX;
+    unsigned long long entity_start = 0, entities = ULLONG_MAX;
+    if (j.count("start"))
+      start = j["start"];
+    if (j.count("stop"))
+      stop = j["stop"];
+    if (j.count("entity_start"))
+      entity_start = j["entity_start"];
+    if (j.count("entities"))
+      entities = j["entities"];
+    j["traceinfo"] = trace->idleFractionJSON(start, stop, entity_start, entities, logging);
+  }
+  else if (cmd.compare("idle_at") == 0)
+  {
+    unsigned long long time;
+    unsigned long long entity_start = 0, entities = ULLONG_MAX;
+    time = j["time"];
+    if (j.count("entity_start"))
+      entity_start = j["entity_start"];
+    if (j.count("entities"))
+      entities = j["entities"];
+    j["traceinfo"] = trace->idleAtJSON(time, entity_start, entities, logging);
+  }
   else if (cmd.compare("functions") == 0)
   {
     unsigned long width;
+    unsigned long long start = 0, stop = ULLONG_MAX;
     width = j["width"];
-    j["traceinfo"] = trace->functionRankOverview(width, logging);
+    if (j.count("start"))
+      start = j["start"];
+    if (j.count("stop"))
+      stop = j["stop"];
+    j["traceinfo"] = trace->functionRankOverview(width, start, stop, logging);
     if (server_logging) {
       std::cout << "function ranks called." << std::endl;
     }
@@ -165,7 +358,11 @@ static void ev_handler(struct mg_connection *nc, int ev, void *ev_data) {
 
 
 static void setTrace(std::string dataFileName) {
+    // Dropping the old trace releases its arena in one go, and its names
+    // with the string pool
+    delete trace;
     trace = NULL;
+    StringPool::clear();
     if (dataFileName.length() == 0) {
         std::cout << "No trace file given." << std::endl;
     }
@@ -174,12 +371,12 @@ static void setTrace(std::string dataFileName) {
 
     if (dataFileName.compare(dataFileName.length() - 3, 3, "otf") == 0)
     {
-        trace = importWorker->doImportOTF(dataFileName, logging);
+        trace = importWorker->doImportOTF(dataFileName, &import_options, logging);
         trace_set = true;
     }
     else if (dataFileName.compare(dataFileName.length() - 4, 4, "otf2") == 0)
     {
-        trace = importWorker->doImportOTF2(dataFileName, logging);
+        trace = importWorker->doImportOTF2(dataFileName, &import_options, logging);
         trace_set = true;
     }
     else
@@ -193,6 +390,8 @@ static void printUsage() {
   fprintf(stderr, "Usage: Ravel [options] -t /path/to/file.OTF2\n");
   fprintf(stderr, "    -l : Ravel internal logging\n");
   fprintf(stderr, "    -e : Extended tooltips in Gantt viewer\n");
+  fprintf(stderr, "    -c <span> : Coalesce runs of repeated calls no longer than span\n");
+  fprintf(stderr, "    -x : Rank functions by self time instead of call count\n");
 }
 
 int main(int argc, char *argv[]) {
@@ -251,13 +450,16 @@ int main(int argc, char *argv[]) {
     */
     if (strcmp(argv[i], "-t") == 0 && i + 1 < argc) {
         filename = argv[++i];
-        setTrace(filename);
-    } else if (strcmp(argv[i], "-l") == 0 && i + 1 < argc) { // Logging in Traveler C++
+    } else if (strcmp(argv[i], "-l") == 0) { // Logging in Traveler C++
         logging = true;
-    } else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) { // Logging in Mongoose C++
+    } else if (strcmp(argv[i], "-s") == 0) { // Logging in Mongoose C++
         server_logging = true;
-    } else if (strcmp(argv[i], "-e") == 0 && i + 1 < argc) { // Extended tool tips
+    } else if (strcmp(argv[i], "-e") == 0) { // Extended tool tips
         extended_tips = true;
+    } else if (strcmp(argv[i], "-c") == 0 && i + 1 < argc) { // Coalesce short calls
+        import_options.coalesceSpan = std::stoull(argv[++i]);
+    } else if (strcmp(argv[i], "-x") == 0) { // Rank by self time
+        import_options.rankBySelfTime = true;
     } else {
       fprintf(stderr, "%d %s\n", strcmp(argv[i], "-e"), argv[i]);
       fprintf(stderr, "Unknown option: [%s]\n", argv[i]);
@@ -266,6 +468,11 @@ int main(int argc, char *argv[]) {
     }
   }
 
+  /* Load the trace once all options are known */
+  if (filename.length() > 0) {
+    setTrace(filename);
+  }
+
   /* Set HTTP server options */
 
   if (!trace_set) {
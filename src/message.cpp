@@ -1,13 +1,23 @@
 #include "message.h"
-#include "commevent.h"
-#include "p2pevent.h"
+#include "event.h"
 
 Message::Message(unsigned long long send, unsigned long long recv, int group)
-    : sender(NULL), receiver(NULL),
-      sendtime(send), recvtime(recv), entitygroup(group), tag(0), id(0)
+    : sender_entity(0), sender_index(no_event),
+      receiver_entity(0), receiver_index(no_event),
+      sendtime(send), recvtime(recv), entitygroup(group), tag(0), size(0), id(0)
 {
 }
 
+bool Message::sentBy(const Event * evt) const
+{
+    return sender_index == evt->index && sender_entity == evt->entity;
+}
+
+bool Message::receivedBy(const Event * evt) const
+{
+    return receiver_index == evt->index && receiver_entity == evt->entity;
+}
+
 bool Message::operator<(const Message &message)
 {
     return sendtime < message.sendtime;
@@ -34,19 +44,14 @@ bool Message::operator==(const Message &message)
 }
 
 
-CommEvent * Message::getDesignee()
-{
-    return sender;
-}
-
 void to_json(json& j, const Message& m)
 {
     j = json{
         {"id", m.id},
         {"sendtime", m.sendtime},
         {"recvtime", m.recvtime},
-        {"sender_entity", m.sender->entity},
-        {"receiver_entity", m.receiver->entity}
+        {"sender_entity", m.sender_entity},
+        {"receiver_entity", m.receiver_entity}
     };
 }
 
@@ -67,8 +72,8 @@ void to_json(json& j, const Message * m)
         {"id", m->id},
         {"sendtime", m->sendtime},
         {"recvtime", m->recvtime},
-        {"sender_entity", m->sender->entity},
-        {"receiver_entity", m->receiver->entity}
+        {"sender_entity", m->sender_entity},
+        {"receiver_entity", m->receiver_entity}
     };
 }
 
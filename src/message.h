@@ -3,26 +3,42 @@
 
 #include <nlohmann/json.hpp>
 
-class P2PEvent;
-class CommEvent;
+class Event;
 
 using json = nlohmann::json;
 
-// Holder of message info
+// Holder of message info. Messages live contiguously in Trace::messages,
+// so their endpoints are (entity, index into Trace::events) pairs rather
+// than pointers.
 class Message
 {
 public:
     Message(unsigned long long send, unsigned long long recv,
             int group);
-    P2PEvent * sender;
-    P2PEvent * receiver;
+    unsigned long sender_entity;
+    unsigned long sender_index;
+    unsigned long receiver_entity;
+    unsigned long receiver_index;
     unsigned long long sendtime;
     unsigned long long recvtime;
     int entitygroup;
     unsigned int tag;
     unsigned long long size;
 
-    CommEvent * getDesignee();
+    void setSender(unsigned long entity, unsigned long index)
+    {
+        sender_entity = entity;
+        sender_index = index;
+    }
+    void setReceiver(unsigned long entity, unsigned long index)
+    {
+        receiver_entity = entity;
+        receiver_index = index;
+    }
+    bool hasSender() const { return sender_index != no_event; }
+    bool hasReceiver() const { return receiver_index != no_event; }
+    bool sentBy(const Event * evt) const;
+    bool receivedBy(const Event * evt) const;
 
     void setID(unsigned long long i) { id = i; }
 
@@ -33,6 +49,13 @@ public:
     bool operator<=(const Message &);
     bool operator>=(const Message &);
     bool operator==(const Message &);
+
+    static bool messageSendLessThan(const Message& m1, const Message& m2)
+    {
+        return m1.sendtime < m2.sendtime;
+    }
+
+    static const unsigned long no_event = static_cast<unsigned long>(-1);
 };
 
 void to_json(json& j, const Message& e);
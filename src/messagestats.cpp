@@ -0,0 +1,158 @@
+#include "messagestats.h"
+#include "message.h"
+#include "ravelutils.h"
+#include <algorithm>
+
+MessageStats::MessageStats()
+    : messages(NULL),
+      sent_lists(std::vector<List>()),
+      received_lists(std::vector<List>())
+{
+}
+
+MessageStats::Summary::Summary()
+    : latencies(std::vector<unsigned long long>(bins, 0)),
+      sizes(std::vector<unsigned long long>(bins, 0)),
+      peers(std::map<unsigned long, Peer>())
+{
+}
+
+unsigned int MessageStats::bin(unsigned long long value)
+{
+    unsigned int bin = 0;
+    while (bin < 64 && (value >> bin) != 0)
+        bin++;
+    return bin;
+}
+
+static unsigned long long latencyOf(const Message& msg)
+{
+    return (msg.recvtime > msg.sendtime) ? msg.recvtime - msg.sendtime : 0;
+}
+
+void MessageStats::build(std::vector<Message> * _messages, unsigned long entities)
+{
+    messages = _messages;
+    sent_lists.assign(entities, List());
+    received_lists.assign(entities, List());
+    for (unsigned long m = 0; m < messages->size(); m++)
+    {
+        const Message& msg = messages->at(m);
+        if (!msg.hasSender() || !msg.hasReceiver())
+            continue;
+        sent_lists[msg.sender_entity].messages.push_back(m);
+        received_lists[msg.receiver_entity].messages.push_back(m);
+    }
+
+    RavelUtils::parallelFor(0, entities, [this](unsigned long entity) {
+        List& sends = sent_lists[entity];
+        for (std::vector<unsigned long>::iterator m = sends.messages.begin();
+             m != sends.messages.end(); ++m)
+        {
+            sends.times.push_back(messages->at(*m).sendtime);
+        }
+        buildBlocks(sends, false);
+
+        List& receives = received_lists[entity];
+        std::vector<std::pair<unsigned long long, unsigned long> > by_receive;
+        for (std::vector<unsigned long>::iterator m = receives.messages.begin();
+             m != receives.messages.end(); ++m)
+        {
+            by_receive.push_back(std::make_pair(messages->at(*m).recvtime, *m));
+        }
+        std::sort(by_receive.begin(), by_receive.end());
+        for (unsigned long i = 0; i < by_receive.size(); i++)
+        {
+            receives.messages[i] = by_receive[i].second;
+            receives.times.push_back(by_receive[i].first);
+        }
+        buildBlocks(receives, true);
+    });
+}
+
+void MessageStats::buildBlocks(List& list, bool received)
+{
+    for (unsigned long first = 0; first < list.messages.size(); first += block_size)
+    {
+        unsigned long last = std::min(first + block_size, static_cast<unsigned long>(list.messages.size()));
+        Block block;
+        block.histogram = list.histograms.size();
+        list.histograms.resize(list.histograms.size() + 2 * bins, 0);
+
+        std::map<unsigned long, Peer> peers = std::map<unsigned long, Peer>();
+        for (unsigned long i = first; i < last; i++)
+        {
+            const Message& msg = messages->at(list.messages[i]);
+            unsigned long long latency = latencyOf(msg);
+            list.histograms[block.histogram + bin(latency)]++;
+            list.histograms[block.histogram + bins + bin(msg.size)]++;
+
+            Peer& peer = peers[received ? msg.sender_entity : msg.receiver_entity];
+            peer.count++;
+            peer.bytes += msg.size;
+            peer.latency += latency;
+            peer.max_latency = std::max(peer.max_latency, latency);
+        }
+
+        block.peers_begin = list.peer_entries.size();
+        for (std::map<unsigned long, Peer>::iterator peer = peers.begin(); peer != peers.end(); ++peer)
+        {
+            PeerEntry entry = { peer->first, peer->second };
+            list.peer_entries.push_back(entry);
+        }
+        block.peers_end = list.peer_entries.size();
+        list.blocks.push_back(block);
+    }
+}
+
+void MessageStats::addMessage(const Message& msg, bool received, Summary& summary) const
+{
+    unsigned long long latency = latencyOf(msg);
+    summary.latencies[bin(latency)]++;
+    summary.sizes[bin(msg.size)]++;
+
+    Peer& peer = summary.peers[received ? msg.sender_entity : msg.receiver_entity];
+    peer.count++;
+    peer.bytes += msg.size;
+    peer.latency += latency;
+    peer.max_latency = std::max(peer.max_latency, latency);
+}
+
+void MessageStats::window(unsigned long entity, bool received,
+                          unsigned long long start, unsigned long long stop,
+                          Summary& summary) const
+{
+    const List& list = received ? received_lists[entity] : sent_lists[entity];
+    unsigned long position = std::lower_bound(list.times.begin(), list.times.end(), start)
+                             - list.times.begin();
+    unsigned long last = std::lower_bound(list.times.begin(), list.times.end(), stop)
+                         - list.times.begin();
+    while (position < last)
+    {
+        // Whole blocks from their summaries, the edges message by message
+        if (position % block_size == 0 && position + block_size <= last)
+        {
+            const Block& block = list.blocks[position / block_size];
+            for (unsigned int b = 0; b < bins; b++)
+            {
+                summary.latencies[b] += list.histograms[block.histogram + b];
+                summary.sizes[b] += list.histograms[block.histogram + bins + b];
+            }
+            for (unsigned long p = block.peers_begin; p < block.peers_end; p++)
+            {
+                const PeerEntry& entry = list.peer_entries[p];
+                Peer& peer = summary.peers[entry.peer];
+                peer.count += entry.totals.count;
+                peer.bytes += entry.totals.bytes;
+                peer.latency += entry.totals.latency;
+                peer.max_latency = std::max(peer.max_latency, entry.totals.max_latency);
+            }
+            position += block_size;
+        }
+        else
+        {
+            addMessage(messages->at(list.messages[position]), received, summary);
+            position++;
+        }
+    }
+}
@@ -0,0 +1,81 @@
+#ifndef MESSAGESTATS_H
+#define MESSAGESTATS_H
+
+#include <map>
+#include <vector>
+#include <stdint.h>
+
+class Message;
+
+// Latency and size distributions of matched messages for any window and
+// entities, from either the sending or the receiving side. Each entity's
+// messages are listed by send time as sent and by receive time as
+// received, and cut into blocks that keep log2 histograms and per peer
+// totals. A window merges the blocks it covers and scans only the
+// messages of the blocks at its edges.
+class MessageStats
+{
+public:
+    MessageStats();
+
+    // Messages must be sorted by send time and outlive the stats
+    void build(std::vector<Message> * _messages, unsigned long entities);
+
+    struct Peer {
+        unsigned long long count;
+        unsigned long long bytes;
+        unsigned long long latency; // Total
+        unsigned long long max_latency;
+    };
+
+    struct Summary {
+        Summary();
+        std::vector<unsigned long long> latencies; // By bin
+        std::vector<unsigned long long> sizes;
+        std::map<unsigned long, Peer> peers; // By the other entity
+    };
+
+    // Add the messages entity sent, or received, from start to stop
+    void window(unsigned long entity, bool received,
+                unsigned long long start, unsigned long long stop,
+                Summary& summary) const;
+
+    // Bin 0 holds 0, bin i from 1 << (i - 1) up to 1 << i
+    static unsigned int bin(unsigned long long value);
+    static unsigned long long binFloor(unsigned int bin)
+    {
+        return (bin == 0) ? 0 : 1ULL << (bin - 1);
+    }
+
+    static const unsigned int bins = 65;
+    static const unsigned int block_size = 256;
+
+private:
+    struct PeerEntry {
+        unsigned long peer;
+        Peer totals;
+    };
+
+    struct Block {
+        unsigned long histogram; // Latency then size counts in histograms
+        unsigned long peers_begin; // Range in peer_entries
+        unsigned long peers_end;
+    };
+
+    struct List {
+        std::vector<unsigned long> messages; // Positions in messages
+        std::vector<unsigned long long> times;
+        std::vector<Block> blocks;
+        std::vector<uint32_t> histograms;
+        std::vector<PeerEntry> peer_entries;
+    };
+
+    void addMessage(const Message& msg, bool received, Summary& summary) const;
+    void buildBlocks(List& list, bool received);
+
+    std::vector<Message> * messages;
+    std::vector<List> sent_lists;
+    std::vector<List> received_lists;
+};
+
+#endif // MESSAGESTATS_H
@@ -1,42 +1,83 @@
 #include "metrics.h"
+#include <algorithm>
 
-Metrics::Metrics()
-    : metrics(new std::map<std::string, double>())
+Metrics::Metrics(std::vector<std::string> * _names, Arena * arena)
+    : names(_names),
+      metrics(ArenaAllocator<MetricValue>(arena))
 {
 }
 
 Metrics::~Metrics()
 {
-    delete metrics;
+}
+
+// Index of the metric name, registering it with the trace if asked to.
+// Unknown names otherwise give -1.
+int Metrics::nameIndex(const std::string& name, bool add)
+{
+    for (unsigned int i = 0; i < names->size(); i++)
+    {
+        if (names->at(i) == name)
+            return i;
+    }
+    if (!add)
+        return -1;
+    names->push_back(name);
+    return names->size() - 1;
 }
 
 void Metrics::addMetric(std::string name, double event_value)
 {
-    (*metrics)[name] = event_value;
+    setMetric(name, event_value);
 }
 
 void Metrics::setMetric(std::string name, double event_value)
 {
-    (*metrics)[name] = event_value;
+    int index = nameIndex(name, true);
+    for (std::vector<MetricValue, ArenaAllocator<MetricValue> >::iterator metric
+         = metrics.begin(); metric != metrics.end(); ++metric)
+    {
+        if (metric->first == index)
+        {
+            metric->second = event_value;
+            return;
+        }
+    }
+    metrics.push_back(MetricValue(index, event_value));
 }
 
 bool Metrics::hasMetric(std::string name)
 {
-    return (metrics->find(name) != metrics->end());
+    int index = nameIndex(name, false);
+    for (std::vector<MetricValue, ArenaAllocator<MetricValue> >::iterator metric
+         = metrics.begin(); metric != metrics.end(); ++metric)
+    {
+        if (metric->first == index)
+            return true;
+    }
+    return false;
 }
 
 double Metrics::getMetric(std::string name)
 {
-    return ((*metrics)[name]);
+    int index = nameIndex(name, false);
+    for (std::vector<MetricValue, ArenaAllocator<MetricValue> >::iterator metric
+         = metrics.begin(); metric != metrics.end(); ++metric)
+    {
+        if (metric->first == index)
+            return metric->second;
+    }
+    return 0;
 }
 
 std::vector<std::string> Metrics::getMetricList()
 {
-    std::vector<std::string> names = std::vector<std::string>();
-    for (std::map<std::string, double>::iterator counter = metrics->begin();
-         counter != metrics->end(); ++counter)
+    std::vector<std::string> list = std::vector<std::string>();
+    for (std::vector<MetricValue, ArenaAllocator<MetricValue> >::iterator metric
+         = metrics.begin(); metric != metrics.end(); ++metric)
     {
-        names.push_back(counter->first);
+        list.push_back(names->at(metric->first));
     }
-    return names;
+    std::sort(list.begin(), list.end());
+    return list;
 }
@@ -1,14 +1,16 @@
 #ifndef METRICS_H
 #define METRICS_H
 
-#include <map>
 #include <string>
 #include <vector>
+#include "arena.h"
 
+// Metric values of one event, keyed by position in the trace's list of
+// metric names. Lives in the trace arena along with its event.
 class Metrics
 {
 public:
-    Metrics();
+    Metrics(std::vector<std::string> * _names, Arena * arena);
     ~Metrics();
     void addMetric(std::string name, double event_value);
     void setMetric(std::string name, double event_value);
@@ -16,7 +18,13 @@ public:
     double getMetric(std::string name);
     std::vector<std::string> getMetricList();
 
-    std::map<std::string, double> * metrics; // Lateness or Counters etc
+    typedef std::pair<int, double> MetricValue;
+
+    std::vector<std::string> * names; // Trace metric names
+    std::vector<MetricValue, ArenaAllocator<MetricValue> > metrics; // Lateness or Counters etc
+
+private:
+    int nameIndex(const std::string& name, bool add);
 };
 
 #endif // METRICS_H
@@ -0,0 +1,112 @@
+#include "occurrenceindex.h"
+#include "event.h"
+#include <algorithm>
+
+OccurrenceIndex::OccurrenceIndex()
+    : indices(std::vector<unsigned long>()),
+      enters(std::vector<unsigned long long>()),
+      function_keys(std::vector<int>()),
+      function_offsets(std::vector<unsigned long>()),
+      run_list(std::vector<Run>()),
+      reach(std::vector<unsigned long long>())
+{
+}
+
+void OccurrenceIndex::build(std::vector<std::vector<Event *> *> * events)
+{
+    struct Call {
+        int function;
+        unsigned long entity;
+        unsigned long long enter;
+        unsigned long long exit;
+        unsigned long index;
+        bool operator<(const Call& other) const
+        {
+            if (function != other.function)
+                return function < other.function;
+            if (entity != other.entity)
+                return entity < other.entity;
+            return enter < other.enter;
+        }
+    };
+
+    std::vector<Call> calls = std::vector<Call>();
+    for (unsigned long entity = 0; entity < events->size(); entity++)
+    {
+        for (std::vector<Event *>::iterator evt = events->at(entity)->begin();
+             evt != events->at(entity)->end(); ++evt)
+        {
+            Call call = { (*evt)->function, entity, (*evt)->enter, (*evt)->exit, (*evt)->index };
+            calls.push_back(call);
+        }
+    }
+    std::stable_sort(calls.begin(), calls.end());
+
+    indices.clear();
+    enters.clear();
+    reach.clear();
+    function_keys.clear();
+    function_offsets.clear();
+    run_list.clear();
+    indices.reserve(calls.size());
+    enters.reserve(calls.size());
+    reach.reserve(calls.size());
+    for (unsigned long i = 0; i < calls.size(); i++)
+    {
+        if (i == 0 || calls[i].function != calls[i - 1].function)
+        {
+            function_keys.push_back(calls[i].function);
+            function_offsets.push_back(run_list.size());
+        }
+        if (i == 0 || calls[i].function != calls[i - 1].function
+            || calls[i].entity != calls[i - 1].entity)
+        {
+            Run run = { calls[i].entity, i, i };
+            run_list.push_back(run);
+            reach.push_back(calls[i].exit);
+        }
+        else
+        {
+            reach.push_back(std::max(reach.back(), calls[i].exit));
+        }
+        run_list.back().end = i + 1;
+        indices.push_back(calls[i].index);
+        enters.push_back(calls[i].enter);
+    }
+    function_offsets.push_back(run_list.size());
+}
+
+void OccurrenceIndex::runs(int function, unsigned long entity_start, unsigned long entity_stop,
+                           const Run ** first, const Run ** last) const
+{
+    *first = NULL;
+    *last = NULL;
+    std::vector<int>::const_iterator key = std::lower_bound(function_keys.begin(),
+                                                            function_keys.end(), function);
+    if (key == function_keys.end() || *key != function)
+        return;
+
+    unsigned long slot = key - function_keys.begin();
+    const Run * begin = &run_list[0] + function_offsets[slot];
+    const Run * end = &run_list[0] + function_offsets[slot + 1];
+    *first = std::lower_bound(begin, end, entity_start, runEntityLessThan);
+    *last = std::lower_bound(*first, end, entity_stop, runEntityLessThan);
+}
+
+unsigned long OccurrenceIndex::firstActiveAt(const Run& run, unsigned long long time) const
+{
+    return std::upper_bound(reach.begin() + run.begin, reach.begin() + run.end, time)
+           - reach.begin();
+}
+
+unsigned long OccurrenceIndex::firstAfter(const Run& run, unsigned long long time) const
+{
+    return std::upper_bound(enters.begin() + run.begin, enters.begin() + run.end, time)
+           - enters.begin();
+}
+
+unsigned long OccurrenceIndex::firstFrom(const Run& run, unsigned long long time) const
+{
+    return std::lower_bound(enters.begin() + run.begin, enters.begin() + run.end, time)
+           - enters.begin();
+}
@@ -0,0 +1,58 @@
+#ifndef OCCURRENCEINDEX_H
+#define OCCURRENCEINDEX_H
+
+#include <vector>
+
+class Event;
+
+// Every call of every function, grouped by function and then by entity.
+// A function's runs only cover the entities that call it, so filtered
+// queries skip the others outright. Within a run, calls are in enter
+// order with the running maximum exit, so the calls overlapping a window
+// or the next call after a time are a binary search away.
+class OccurrenceIndex
+{
+public:
+    OccurrenceIndex();
+
+    void build(std::vector<std::vector<Event *> *> * events);
+
+    // Calls of one function on one entity, positions begin up to end
+    struct Run {
+        unsigned long entity;
+        unsigned long begin;
+        unsigned long end;
+    };
+
+    // Runs of a function on entities entity_start up to entity_stop, in
+    // entity order, or NULL and NULL if none
+    void runs(int function, unsigned long entity_start, unsigned long entity_stop,
+              const Run ** first, const Run ** last) const;
+
+    // Every run, by function and then entity
+    const std::vector<Run>& allRuns() const { return run_list; }
+
+    // First position in a run that may still be running at time
+    unsigned long firstActiveAt(const Run& run, unsigned long long time) const;
+    // First position in a run entering after time
+    unsigned long firstAfter(const Run& run, unsigned long long time) const;
+    // First position in a run entering at or after time
+    unsigned long firstFrom(const Run& run, unsigned long long time) const;
+
+    // Index into Trace::events of the entity
+    std::vector<unsigned long> indices;
+    std::vector<unsigned long long> enters;
+
+private:
+    std::vector<int> function_keys;
+    std::vector<unsigned long> function_offsets; // Into run_list
+    std::vector<Run> run_list;
+    std::vector<unsigned long long> reach; // Running maximum exit per run
+
+    static bool runEntityLessThan(const Run& run, unsigned long entity)
+    {
+        return run.entity < entity;
+    }
+};
+
+#endif // OCCURRENCEINDEX_H
@@ -15,6 +15,7 @@
 #include "function.h"
 #include "entity.h"
 #include "primaryentitygroup.h"
+#include "systemnode.h"
 
 OTF2Importer::OTF2Importer()
     : from_saved_version(""),
@@ -30,10 +31,11 @@ OTF2Importer::OTF2Importer()
       otfReader(NULL),
       global_def_callbacks(NULL),
       global_evt_callbacks(NULL),
-      stringMap(new std::map<OTF2_StringRef, std::string>()),
+      stringMap(new std::map<OTF2_StringRef, StringPool::Handle>()),
       attributeMap(new std::map<OTF2_AttributeRef, OTF2Attribute *>()),
       locationMap(new std::map<OTF2_LocationRef, OTF2Location *>()),
       locationGroupMap(new std::map<OTF2_LocationGroupRef, OTF2LocationGroup *>()),
+      systemTreeMap(new std::map<OTF2_SystemTreeNodeRef, OTF2SystemTreeNode *>()),
       regionMap(new std::map<OTF2_RegionRef, OTF2Region *>()),
       commMap(new std::map<OTF2_CommRef, OTF2Comm *>()),
       groupMap(new std::map<OTF2_GroupRef, OTF2Group *>()),
@@ -43,6 +45,7 @@ OTF2Importer::OTF2Importer()
       threadList(std::vector<OTF2Location *>()),
       MPILocations(std::set<OTF2_LocationRef>()),
       processingElements(NULL),
+      system_tree(NULL),
       unmatched_recvs(new std::vector<std::list<CommRecord *> *>()),
       unmatched_sends(new std::vector<std::list<CommRecord *> *>()),
       unmatched_send_requests(new std::vector<std::list<CommRecord *> *>()),
@@ -69,29 +72,29 @@ OTF2Importer::OTF2Importer()
       multi_map(new std::map<uint64_t, MultiRecord *>()),
       logging(false)
 {
-    collective_definitions->insert(std::pair<int, OTFCollective*>(0, new OTFCollective(0, 1, "Barrier")));
-    collective_definitions->insert(std::pair<int, OTFCollective*>(1, new OTFCollective(1, 2, "Bcast")));
-    collective_definitions->insert(std::pair<int, OTFCollective*>(2, new OTFCollective(2, 3, "Gather")));
-    collective_definitions->insert(std::pair<int, OTFCollective*>(3, new OTFCollective(3, 3, "Gatherv")));
-    collective_definitions->insert(std::pair<int, OTFCollective*>(4, new OTFCollective(4, 2, "Scatter")));
-    collective_definitions->insert(std::pair<int, OTFCollective*>(5, new OTFCollective(5, 2, "Scatterv")));
-    collective_definitions->insert(std::pair<int, OTFCollective*>(6, new OTFCollective(6, 4, "Allgather")));
-    collective_definitions->insert(std::pair<int, OTFCollective*>(7, new OTFCollective(7, 4, "Allgatherv")));
-    collective_definitions->insert(std::pair<int, OTFCollective*>(8, new OTFCollective(8, 4, "Alltoall")));
-    collective_definitions->insert(std::pair<int, OTFCollective*>(9, new OTFCollective(9, 4, "Alltoallv")));
-    collective_definitions->insert(std::pair<int, OTFCollective*>(10, new OTFCollective(10, 4, "Alltoallw")));
-    collective_definitions->insert(std::pair<int, OTFCollective*>(11, new OTFCollective(11, 4, "Allreduce")));
-    collective_definitions->insert(std::pair<int, OTFCollective*>(12, new OTFCollective(12, 3, "Reduce")));
-    collective_definitions->insert(std::pair<int, OTFCollective*>(13, new OTFCollective(13, 4, "ReduceScatter")));
-    collective_definitions->insert(std::pair<int, OTFCollective*>(14, new OTFCollective(14, 4, "Scan")));
-    collective_definitions->insert(std::pair<int, OTFCollective*>(15, new OTFCollective(15, 4, "Exscan")));
-    collective_definitions->insert(std::pair<int, OTFCollective*>(16, new OTFCollective(16, 4, "ReduceScatterBlock")));
-    collective_definitions->insert(std::pair<int, OTFCollective*>(17, new OTFCollective(17, 4, "CreateHandle")));
-    collective_definitions->insert(std::pair<int, OTFCollective*>(18, new OTFCollective(18, 4, "DestroyHandle")));
-    collective_definitions->insert(std::pair<int, OTFCollective*>(19, new OTFCollective(19, 4, "Allocate")));
-    collective_definitions->insert(std::pair<int, OTFCollective*>(20, new OTFCollective(20, 4, "Deallocate")));
-    collective_definitions->insert(std::pair<int, OTFCollective*>(21, new OTFCollective(21, 4, "CreateAllocate")));
-    collective_definitions->insert(std::pair<int, OTFCollective*>(22, new OTFCollective(22, 4, "DestroyDeallocate")));
+    collective_definitions->insert(std::pair<int, OTFCollective*>(0, new OTFCollective(0, 1, StringPool::intern("Barrier"))));
+    collective_definitions->insert(std::pair<int, OTFCollective*>(1, new OTFCollective(1, 2, StringPool::intern("Bcast"))));
+    collective_definitions->insert(std::pair<int, OTFCollective*>(2, new OTFCollective(2, 3, StringPool::intern("Gather"))));
+    collective_definitions->insert(std::pair<int, OTFCollective*>(3, new OTFCollective(3, 3, StringPool::intern("Gatherv"))));
+    collective_definitions->insert(std::pair<int, OTFCollective*>(4, new OTFCollective(4, 2, StringPool::intern("Scatter"))));
+    collective_definitions->insert(std::pair<int, OTFCollective*>(5, new OTFCollective(5, 2, StringPool::intern("Scatterv"))));
+    collective_definitions->insert(std::pair<int, OTFCollective*>(6, new OTFCollective(6, 4, StringPool::intern("Allgather"))));
+    collective_definitions->insert(std::pair<int, OTFCollective*>(7, new OTFCollective(7, 4, StringPool::intern("Allgatherv"))));
+    collective_definitions->insert(std::pair<int, OTFCollective*>(8, new OTFCollective(8, 4, StringPool::intern("Alltoall"))));
+    collective_definitions->insert(std::pair<int, OTFCollective*>(9, new OTFCollective(9, 4, StringPool::intern("Alltoallv"))));
+    collective_definitions->insert(std::pair<int, OTFCollective*>(10, new OTFCollective(10, 4, StringPool::intern("Alltoallw"))));
+    collective_definitions->insert(std::pair<int, OTFCollective*>(11, new OTFCollective(11, 4, StringPool::intern("Allreduce"))));
+    collective_definitions->insert(std::pair<int, OTFCollective*>(12, new OTFCollective(12, 3, StringPool::intern("Reduce"))));
+    collective_definitions->insert(std::pair<int, OTFCollective*>(13, new OTFCollective(13, 4, StringPool::intern("ReduceScatter"))));
+    collective_definitions->insert(std::pair<int, OTFCollective*>(14, new OTFCollective(14, 4, StringPool::intern("Scan"))));
+    collective_definitions->insert(std::pair<int, OTFCollective*>(15, new OTFCollective(15, 4, StringPool::intern("Exscan"))));
+    collective_definitions->insert(std::pair<int, OTFCollective*>(16, new OTFCollective(16, 4, StringPool::intern("ReduceScatterBlock"))));
+    collective_definitions->insert(std::pair<int, OTFCollective*>(17, new OTFCollective(17, 4, StringPool::intern("CreateHandle"))));
+    collective_definitions->insert(std::pair<int, OTFCollective*>(18, new OTFCollective(18, 4, StringPool::intern("DestroyHandle"))));
+    collective_definitions->insert(std::pair<int, OTFCollective*>(19, new OTFCollective(19, 4, StringPool::intern("Allocate"))));
+    collective_definitions->insert(std::pair<int, OTFCollective*>(20, new OTFCollective(20, 4, StringPool::intern("Deallocate"))));
+    collective_definitions->insert(std::pair<int, OTFCollective*>(21, new OTFCollective(21, 4, StringPool::intern("CreateAllocate"))));
+    collective_definitions->insert(std::pair<int, OTFCollective*>(22, new OTFCollective(22, 4, StringPool::intern("DestroyDeallocate"))));
 }
 
 OTF2Importer::~OTF2Importer()
@@ -200,6 +203,14 @@ OTF2Importer::~OTF2Importer()
     }
     delete locationGroupMap;
 
+    for (std::map<OTF2_SystemTreeNodeRef, OTF2SystemTreeNode *>::iterator eitr
+         = systemTreeMap->begin();
+         eitr != systemTreeMap->end(); ++eitr)
+    {
+        delete eitr->second;
+    }
+    delete systemTreeMap;
+
     for (std::map<OTF2_RegionRef, OTF2Region *>::iterator eitr
          = regionMap->begin();
          eitr != regionMap->end(); ++eitr)
@@ -306,9 +317,9 @@ RawTrace * OTF2Importer::importOTF2(const char* otf_file, bool _logging)
           std::cout << "Looking up: " << eitr->second->name << " is ";
           std::cout << stringMap->count(eitr->second->name) << std::endl;
         }
-        if (stringMap->at(eitr->second->name) == PHYLANX_GUID_STRING) {
+        if (StringPool::get(stringMap->at(eitr->second->name)) == PHYLANX_GUID_STRING) {
             phylanx_GUID = eitr->first;
-        } else if (stringMap->at(eitr->second->name) == PHYLANX_PARENT_GUID_STRING) {
+        } else if (StringPool::get(stringMap->at(eitr->second->name)) == PHYLANX_PARENT_GUID_STRING) {
             phylanx_Parent_GUID = eitr->first;
             phylanx = true;
             rawtrace->phylanx = true;
@@ -534,6 +545,8 @@ RawTrace * OTF2Importer::importOTF2(const char* otf_file, bool _logging)
 
     defineEntities();
     rawtrace->processingElements = processingElements;
+    defineSystemTree();
+    rawtrace->system_tree = system_tree;
     rawtrace->num_entities = MPILocations.size();
 
     clock_t end = clock();
@@ -559,6 +572,8 @@ void OTF2Importer::setDefCallbacks()
                                                              callbackDefClockProperties);
 
     // Locations
+    OTF2_GlobalDefReaderCallbacks_SetSystemTreeNodeCallback(global_def_callbacks,
+                                                            callbackDefSystemTreeNode);
     OTF2_GlobalDefReaderCallbacks_SetLocationGroupCallback(global_def_callbacks,
                                                            callbackDefLocationGroup);
     OTF2_GlobalDefReaderCallbacks_SetLocationCallback(global_def_callbacks,
@@ -581,7 +596,7 @@ void OTF2Importer::setDefCallbacks()
 void OTF2Importer::defineEntities()
 {
     // Grab only the MPI locations
-    primaries->insert(std::pair<int, PrimaryEntityGroup *>(0, new PrimaryEntityGroup(0, "MPI")));
+    primaries->insert(std::pair<int, PrimaryEntityGroup *>(0, new PrimaryEntityGroup(0, StringPool::intern("MPI"))));
     std::map<OTF2_LocationRef, Entity *> entityMap = std::map<OTF2_LocationRef, Entity *>();
     for (std::map<OTF2_LocationRef, OTF2Location *>::iterator loc = locationMap->begin();
          loc != locationMap->end(); ++loc)
@@ -601,7 +616,7 @@ void OTF2Importer::defineEntities()
                     std::stringstream ss;
                     ss << loc->second->group;
                     Entity * locationEntity = new Entity(entity,
-                                                         ss.str(),
+                                                         StringPool::intern(ss.str()),
                                                          primaries->at(0));
                     primaries->at(0)->entities->insert(primaries->at(0)->entities->begin() + entity, locationEntity);
                     entityMap.insert(std::pair<OTF2_LocationRef, Entity *>(loc->first, locationEntity));
@@ -610,7 +625,7 @@ void OTF2Importer::defineEntities()
         }
     }
 
-    processingElements = new PrimaryEntityGroup(1, "PEs");
+    processingElements = new PrimaryEntityGroup(1, StringPool::intern("PEs"));
     std::sort(threadList.begin(), threadList.end());
     for (std::vector<OTF2Location *>::iterator loc = threadList.begin();
          loc != threadList.end(); ++loc)
@@ -631,6 +646,68 @@ void OTF2Importer::defineEntities()
 
 }
 
+// Machine hierarchy as system tree nodes, then location groups under
+// their system tree parent, then every thread entity under its group
+void OTF2Importer::defineSystemTree()
+{
+    system_tree = new std::vector<SystemNode *>();
+
+    std::map<OTF2_SystemTreeNodeRef, unsigned long> nodeIndexMap
+        = std::map<OTF2_SystemTreeNodeRef, unsigned long>();
+    for (std::map<OTF2_SystemTreeNodeRef, OTF2SystemTreeNode *>::iterator node = systemTreeMap->begin();
+         node != systemTreeMap->end(); ++node)
+    {
+        nodeIndexMap.insert(std::pair<OTF2_SystemTreeNodeRef, unsigned long>(node->first, system_tree->size()));
+        system_tree->push_back(new SystemNode(system_tree->size(),
+                                              stringMap->at(node->second->name),
+                                              stringMap->at(node->second->class_name),
+                                              -1));
+    }
+    for (std::map<OTF2_SystemTreeNodeRef, OTF2SystemTreeNode *>::iterator node = systemTreeMap->begin();
+         node != systemTreeMap->end(); ++node)
+    {
+        std::map<OTF2_SystemTreeNodeRef, unsigned long>::iterator parent
+            = nodeIndexMap.find(node->second->parent);
+        if (parent != nodeIndexMap.end())
+        {
+            system_tree->at(nodeIndexMap.at(node->first))->parent = parent->second;
+            system_tree->at(parent->second)->children->push_back(nodeIndexMap.at(node->first));
+        }
+    }
+
+    StringPool::Handle group_class = StringPool::intern("location group");
+    std::map<OTF2_LocationGroupRef, unsigned long> groupIndexMap
+        = std::map<OTF2_LocationGroupRef, unsigned long>();
+    for (std::map<OTF2_LocationGroupRef, OTF2LocationGroup *>::iterator group = locationGroupMap->begin();
+         group != locationGroupMap->end(); ++group)
+    {
+        long parent = -1;
+        if (nodeIndexMap.count(group->second->parent))
+            parent = nodeIndexMap.at(group->second->parent);
+        groupIndexMap.insert(std::pair<OTF2_LocationGroupRef, unsigned long>(group->first, system_tree->size()));
+        if (parent >= 0)
+            system_tree->at(parent)->children->push_back(system_tree->size());
+        system_tree->push_back(new SystemNode(system_tree->size(),
+                                              stringMap->at(group->second->name),
+                                              group_class, parent));
+    }
+
+    StringPool::Handle location_class = StringPool::intern("location");
+    for (std::vector<OTF2Location *>::iterator loc = threadList.begin();
+         loc != threadList.end(); ++loc)
+    {
+        long parent = -1;
+        if (groupIndexMap.count((*loc)->group))
+            parent = groupIndexMap.at((*loc)->group);
+        if (parent >= 0)
+            system_tree->at(parent)->children->push_back(system_tree->size());
+        SystemNode * leaf = new SystemNode(system_tree->size(), stringMap->at((*loc)->name),
+                                           location_class, parent);
+        leaf->entity = locationIndexMap->at((*loc)->self);
+        system_tree->push_back(leaf);
+    }
+}
+
 void OTF2Importer::processDefinitions()
 {
     int index = 1;
@@ -749,7 +826,7 @@ OTF2_CallbackCode OTF2Importer::callbackDefString(void * userData,
                                                   OTF2_StringRef self,
                                                   const char * string)
 {
-    ((OTF2Importer*) userData)->stringMap->insert(std::pair<OTF2_StringRef, std::string>(self, std::string(string)));
+    ((OTF2Importer*) userData)->stringMap->insert(std::pair<OTF2_StringRef, StringPool::Handle>(self, StringPool::intern(string)));
     return OTF2_CALLBACK_SUCCESS;
 }
 
@@ -765,6 +842,18 @@ OTF2_CallbackCode OTF2Importer::callbackDefAttribute(void * userData,
 }
 
 
+OTF2_CallbackCode OTF2Importer::callbackDefSystemTreeNode(void * userData,
+                                                          OTF2_SystemTreeNodeRef self,
+                                                          OTF2_StringRef name,
+                                                          OTF2_StringRef className,
+                                                          OTF2_SystemTreeNodeRef parent)
+{
+    OTF2SystemTreeNode * n = new OTF2SystemTreeNode(self, name, className, parent);
+    (*(((OTF2Importer*) userData)->systemTreeMap))[self] = n;
+    return OTF2_CALLBACK_SUCCESS;
+}
+
+
 OTF2_CallbackCode OTF2Importer::callbackDefLocationGroup(void * userData,
                                                          OTF2_LocationGroupRef self,
                                                          OTF2_StringRef name,
@@ -1411,7 +1500,7 @@ void OTF2Importer::processCollectives()
                     std::cout << "Error, no matching collective found for";
                     std::cout << " collective type " << int(fragment->op);
                     std::cout << " on communicator ";
-                    std::cout << stringMap->at(commMap->at(fragment->comm)->name).c_str();
+                    std::cout << StringPool::get(stringMap->at(commMap->at(fragment->comm)->name)).c_str();
                     std::cout << " for process " << *process << std::endl;
                 }
                 else
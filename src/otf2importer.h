@@ -7,6 +7,7 @@
 #include <map>
 #include <vector>
 #include <set>
+#include "stringpool.h"
 
 class CommRecord;
 class GUIDRecord;
@@ -19,6 +20,7 @@ class Counter;
 class CollectiveRecord;
 class PrimaryEntityGroup;
 class MultiRecord;
+class SystemNode;
 
 class OTF2Importer
 {
@@ -76,6 +78,20 @@ public:
         OTF2_SystemTreeNodeRef parent;
     };
 
+    class OTF2SystemTreeNode {
+    public:
+        OTF2SystemTreeNode(OTF2_SystemTreeNodeRef _self,
+                           OTF2_StringRef _name,
+                           OTF2_StringRef _class_name,
+                           OTF2_SystemTreeNodeRef _parent)
+            : self(_self), name(_name), class_name(_class_name), parent(_parent) {}
+
+        OTF2_SystemTreeNodeRef self;
+        OTF2_StringRef name;
+        OTF2_StringRef class_name;
+        OTF2_SystemTreeNodeRef parent;
+    };
+
     class OTF2Location {
     public:
         OTF2Location(OTF2_LocationRef _self,
@@ -196,6 +212,11 @@ public:
                                                   OTF2_StringRef name,
                                                   OTF2_StringRef description,
                                                   OTF2_Type type);
+    static OTF2_CallbackCode callbackDefSystemTreeNode(void * userData,
+                                                       OTF2_SystemTreeNodeRef self,
+                                                       OTF2_StringRef name,
+                                                       OTF2_StringRef className,
+                                                       OTF2_SystemTreeNodeRef parent);
     static OTF2_CallbackCode callbackDefLocationGroup(void * userData,
                                                       OTF2_LocationGroupRef self,
                                                       OTF2_StringRef name,
@@ -338,15 +359,17 @@ private:
     void setEvtCallbacks();
     void processCollectives();
     void defineEntities();
+    void defineSystemTree();
 
     OTF2_Reader * otfReader;
     OTF2_GlobalDefReaderCallbacks * global_def_callbacks;
     OTF2_GlobalEvtReaderCallbacks * global_evt_callbacks;
 
-    std::map<OTF2_StringRef, std::string> * stringMap;
+    std::map<OTF2_StringRef, StringPool::Handle> * stringMap;
     std::map<OTF2_AttributeRef, OTF2Attribute *> * attributeMap;
     std::map<OTF2_LocationRef, OTF2Location *> * locationMap;
     std::map<OTF2_LocationGroupRef, OTF2LocationGroup *> * locationGroupMap;
+    std::map<OTF2_SystemTreeNodeRef, OTF2SystemTreeNode *> * systemTreeMap;
     std::map<OTF2_RegionRef, OTF2Region *> * regionMap;
     std::map<OTF2_CommRef, OTF2Comm *> * commMap;
     std::map<OTF2_GroupRef, OTF2Group *> * groupMap;
@@ -358,6 +381,7 @@ private:
     std::vector<OTF2Location *> threadList;
     std::set<OTF2_LocationRef> MPILocations;
     PrimaryEntityGroup * processingElements;
+    std::vector<SystemNode *> * system_tree;
 
     std::vector<std::list<CommRecord *> *> * unmatched_recvs;
     std::vector<std::list<CommRecord *> *> * unmatched_sends;
@@ -1,6 +1,6 @@
 #include "otfcollective.h"
 
-OTFCollective::OTFCollective(int _id, int _type, std::string _name)
+OTFCollective::OTFCollective(int _id, int _type, StringPool::Handle _name)
     : id(_id),
       type(_type),
       name(_name)
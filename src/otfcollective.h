@@ -1,16 +1,16 @@
 #ifndef OTFCOLLECTIVE_H
 #define OTFCOLLECTIVE_H
 
-#include <string>
+#include "stringpool.h"
 
 class OTFCollective
 {
 public:
-    OTFCollective(int _id, int _type, std::string _name);
+    OTFCollective(int _id, int _type, StringPool::Handle _name);
 
     int id;
     int type;
-    std::string name;
+    StringPool::Handle name;
 };
 
 #endif // OTFCOLLECTIVE_H
@@ -28,6 +28,7 @@
 #include "collectiveevent.h"
 #include "primaryentitygroup.h"
 #include "metrics.h"
+#include "importoptions.h"
 
 
 const std::string OTFConverter::collectives_string
@@ -39,6 +40,7 @@ const std::string OTFConverter::collectives_string
 OTFConverter::OTFConverter()
     : rawtrace(NULL), 
       trace(NULL), 
+      options(NULL),
       max_depth(0), 
       globalID(1),
       globalMessageID(1),
@@ -55,9 +57,11 @@ OTFConverter::~OTFConverter()
 }
 
 
-Trace * OTFConverter::importOTF(std::string filename, bool _logging)
+Trace * OTFConverter::importOTF(std::string filename, OTFImportOptions * _options,
+                                bool _logging)
 {
     #ifdef OTF1LIB
+    options = _options;
     logging = _logging;
 
     // Start with the rawtrace similar to what we got from PARAVER
@@ -73,8 +77,10 @@ Trace * OTFConverter::importOTF(std::string filename, bool _logging)
 }
 
 
-Trace * OTFConverter::importOTF2(std::string filename, bool _logging)
+Trace * OTFConverter::importOTF2(std::string filename, OTFImportOptions * _options,
+                                 bool _logging)
 {
+    options = _options;
     logging = _logging;
 
     // Start with the rawtrace similar to what we got from PARAVER
@@ -94,6 +100,8 @@ void OTFConverter::convert()
     clock_t start = clock();
     trace = new Trace(rawtrace->num_entities, rawtrace->num_pes);
     trace->units = rawtrace->second_magnitude;
+    if (options)
+        trace->options = *options;
 
     // Start setting up new Trace
     delete trace->functions;
@@ -101,6 +109,7 @@ void OTFConverter::convert()
     delete trace->functionGroups;
     trace->primaries = rawtrace->primaries;
     trace->processingElements = rawtrace->processingElements;
+    trace->system_tree = rawtrace->system_tree;
     trace->functionGroups = rawtrace->functionGroups;
     trace->collectives = rawtrace->collectives;
     trace->collectiveMap = rawtrace->collectiveMap;
@@ -119,14 +128,16 @@ void OTFConverter::convert()
     }
 
     // Find init and finalize
+    StringPool::Handle init_name = StringPool::intern("MPI_Init");
+    StringPool::Handle finalize_name = StringPool::intern("MPI_Finalize");
     for (std::map<int, Function *>::iterator fxn = trace->functions->begin();
             fxn != trace->functions->end(); ++fxn)
     {
-        if (fxn->second->name.compare("MPI_Init") == 0)
+        if (fxn->second->name == init_name)
         {
             initFunction = fxn->first;
         } 
-        else if (fxn->second->name.compare("MPI_Finalize") == 0)
+        else if (fxn->second->name == finalize_name)
         {
             finalizeFunction = fxn->first;
         }
@@ -145,6 +156,7 @@ void OTFConverter::convert()
     // Convert the events into matching enter and exit
     std::cout << "Matching events" << std::endl;
     matchEvents();
+    sortMessages();
 
     // Sort all the collective records
     for (std::map<unsigned long long, CollectiveRecord *>::iterator cr
@@ -195,6 +207,10 @@ void OTFConverter::matchEvents()
     bool sflag, rflag, isendflag;
     unsigned long long fxnCount = 0;
 
+    // Message indices of the event being built, appended to the
+    // entity's CSR message list when the event is pushed
+    std::vector<unsigned long> event_msgs;
+
     for (int i = 0; i < rawtrace->events->size(); i++)
     {
         std::vector<EventRecord *> * event_list = rawtrace->events->at(i);
@@ -213,6 +229,9 @@ void OTFConverter::matchEvents()
         std::vector<CommRecord *> * recvlist = rawtrace->messages_r->at(i);
         int sindex = 0, rindex = 0;
         CommEvent * prev = NULL;
+
+        std::vector<unsigned long> * message_offsets = trace->message_offsets->at(i);
+        std::vector<unsigned long> * message_list = trace->message_lists->at(i);
         for (std::vector<EventRecord *>::iterator evt = event_list->begin();
              evt != event_list->end(); ++evt)
         {
@@ -220,6 +239,9 @@ void OTFConverter::matchEvents()
             {
                 EventRecord * bgn = stack->top();
                 stack->pop();
+                // Children were pushed already, so this event goes next
+                unsigned long index = (*(trace->events))[(*evt)->entity]->size();
+                event_msgs.clear();
                 if (bgn->time < trace->min_time)
                     trace->min_time = bgn->time;
                 if((*evt)->time > trace->max_time)
@@ -285,28 +307,38 @@ void OTFConverter::matchEvents()
                     }
                 }
 
+                // Fold short repeated calls into the previous sibling
+                if (!cr && !sflag && !rflag
+                    && coalesce(bgn, *evt, stack->empty() ? NULL : stack->top()))
+                {
+                    while (!counterstack->empty() && counterstack->top()->time == bgn->time)
+                    {
+                        counterstack->pop();
+                    }
+                    while (counters->size() > counter_index
+                           && counters->at(counter_index)->time == (*evt)->time)
+                    {
+                        counter_index++;
+                    }
+
+                    depth--;
+                    if ((*evt)->time > endtime)
+                        endtime = (*evt)->time;
+                    addTaskLength(bgn->value, (*evt)->time - bgn->time);
+                    continue;
+                }
+
                 Event * e = NULL;
                 if (rawtrace->phylanx)
                 {
-                    std::vector<Message *> * msgs = new std::vector<Message *>();
-                    P2PEvent * p = new P2PEvent(bgn->time, (*evt)->time,
-                                                bgn->value, bgn->entity,
-                                                bgn->entity, phase, msgs);
+                    P2PEvent * p = trace->arena->make<P2PEvent>(bgn->time, (*evt)->time,
+                                                                bgn->value, bgn->entity,
+                                                                bgn->entity, phase);
+                    initEvent(p, bgn->children.size());
                     p->setID(globalID++);
                     //p->setGUID((*evt)->guid);
                     p->setGUID(bgn->guid);
                     p->setParentGUID(bgn->parent_guid);
-                    if (trace->guidMap->find(p->getGUID()) == trace->guidMap->end())
-                    {
-                        trace->guidMap->insert(
-                            std::pair<uint64_t, 
-                                      std::vector<unsigned long long> *>(p->getGUID(),
-                                                                         new std::vector<unsigned long long>()
-                                                                        )
-                                              );
-                                                
-                    }
-                    trace->guidMap->at(p->getGUID())->push_back(p->id);
                     //std::cout << "guid " << p->guid << " parent_guid " << p->parent_guid << std::endl;
                     if ((*evt)->to_crs) {  // to_crs are collected by the leave
                         for (std::vector<GUIDRecord *>::iterator gitr = (*evt)->to_crs->begin();
@@ -314,14 +346,13 @@ void OTFConverter::matchEvents()
                         {
                             if ((*gitr)->matched)
                             {
-                                if (!(*gitr)->message) {
-                                    (*gitr)->message = new Message((*gitr)->parent_time,
+                                if ((*gitr)->message < 0) {
+                                    (*gitr)->message = makeMessage((*gitr)->parent_time,
                                                                    (*gitr)->child_time,
                                                                    0);
-                                    (*gitr)->message->setID(globalMessageID++);
                                 }
-                                (*gitr)->message->sender = p;
-                                msgs->push_back((*gitr)->message);
+                                trace->messages->at((*gitr)->message).setSender(bgn->entity, index);
+                                event_msgs.push_back((*gitr)->message);
                                 if (logging) {
                                   std::cout << (*gitr)->parent << " to " << (*gitr)->child;
                                   std::cout << " at " << (*gitr)->parent_time << " to ";
@@ -365,12 +396,11 @@ void OTFConverter::matchEvents()
                         {
                             if ((*gitr)->matched) 
                             {
-                                if (!(*gitr)->message) 
+                                if ((*gitr)->message < 0) 
                                 {
-                                    (*gitr)->message = new Message((*gitr)->parent_time,
+                                    (*gitr)->message = makeMessage((*gitr)->parent_time,
                                                                    (*gitr)->child_time,
                                                                    0);
-                                    (*gitr)->message->setID(globalMessageID++);
                                     if (logging) 
                                     {
                                       std::cout << "Creating bgn-evt message: " << (*gitr)->parent;
@@ -378,8 +408,8 @@ void OTFConverter::matchEvents()
                                       std::cout << " to " << (*gitr)->child_time << " : " << (*gitr)->matched << std::endl;
                                     }
                                 }
-                                (*gitr)->message->sender = p;
-                                msgs->push_back((*gitr)->message);
+                                trace->messages->at((*gitr)->message).setSender(bgn->entity, index);
+                                event_msgs.push_back((*gitr)->message);
                             }
                             else
                             {
@@ -395,11 +425,10 @@ void OTFConverter::matchEvents()
 
                     if (bgn->from_cr) { // from cr is collected by the enter
                         if (bgn->from_cr->matched) {
-                            if (!bgn->from_cr->message) {
-                                bgn->from_cr->message = new Message(bgn->from_cr->parent_time,
+                            if (bgn->from_cr->message < 0) {
+                                bgn->from_cr->message = makeMessage(bgn->from_cr->parent_time,
                                                                     bgn->from_cr->child_time,
                                                                     0);
-                                bgn->from_cr->message->setID(globalMessageID++);
                                 if (logging) 
                                 {
                                   std::cout << bgn->from_cr->parent << " to " << bgn->from_cr->child;
@@ -407,8 +436,8 @@ void OTFConverter::matchEvents()
                                   std::cout << bgn->from_cr->child_time <<  std::endl;
                                 }
                             }
-                            bgn->from_cr->message->receiver = p;
-                            msgs->push_back(bgn->from_cr->message);
+                            trace->messages->at(bgn->from_cr->message).setReceiver(bgn->entity, index);
+                            event_msgs.push_back(bgn->from_cr->message);
                             /* p->comm_prev = prev;
                             if (prev)
                                 prev->comm_next = p;
@@ -416,7 +445,7 @@ void OTFConverter::matchEvents()
                             */
                         }
                     }
-                    if (!msgs->empty())
+                    if (!event_msgs.empty())
                     {
                         p->comm_prev = prev;
                         if (prev)
@@ -433,9 +462,10 @@ void OTFConverter::matchEvents()
                 }
                 else if (cr)
                 {
-                    cr->events->push_back(new CollectiveEvent(bgn->time, (*evt)->time,
+                    cr->events->push_back(trace->arena->make<CollectiveEvent>(bgn->time, (*evt)->time,
                                             bgn->value, bgn->entity, bgn->entity,
                                             phase, cr));
+                    initEvent(cr->events->back(), bgn->children.size());
                     if (!rawtrace->phylanx)
                         cr->events->back()->setID(globalID++);
                     cr->events->back()->comm_prev = prev;
@@ -452,105 +482,93 @@ void OTFConverter::matchEvents()
                 }
                 else if (sflag)
                 {
-                    std::vector<Message *> * msgs = new std::vector<Message *>();
                     CommRecord * crec = sendlist->at(sindex);
-                    if (!(crec->message))
+                    if (crec->message < 0)
                     {
-                        crec->message = new Message(crec->send_time,
+                        crec->message = makeMessage(crec->send_time,
                                                     crec->recv_time,
                                                     crec->group);
-                        crec->message->tag = crec->tag;
-                        crec->message->size = crec->size;
-                        crec->message->setID(globalMessageID++);
+                        trace->messages->at(crec->message).tag = crec->tag;
+                        trace->messages->at(crec->message).size = crec->size;
                     }
-                    msgs->push_back(crec->message);
-                    crec->message->sender = new P2PEvent(bgn->time, (*evt)->time,
-                                                         bgn->value,
-                                                         bgn->entity, bgn->entity, phase,
-                                                         msgs);
+                    event_msgs.push_back(crec->message);
+                    P2PEvent * sender = trace->arena->make<P2PEvent>(bgn->time, (*evt)->time,
+                                                                     bgn->value,
+                                                                     bgn->entity, bgn->entity, phase);
+                    initEvent(sender, bgn->children.size());
+                    trace->messages->at(crec->message).setSender(bgn->entity, index);
 
                     if (!rawtrace->phylanx)
-                        crec->message->sender->setID(globalID++);
+                        sender->setID(globalID++);
 
-                    crec->message->sender->comm_prev = prev;
+                    sender->comm_prev = prev;
                     if (prev)
-                        prev->comm_next = crec->message->sender;
-                    prev = crec->message->sender;
+                        prev->comm_next = sender;
+                    prev = sender;
 
-                    counter_index = advanceCounters(crec->message->sender,
+                    counter_index = advanceCounters(sender,
                                                     counterstack,
                                                     counters, counter_index,
                                                     lastcounters);
 
-                    e = crec->message->sender;
+                    e = sender;
                     sindex++;
                 }
                 else if (rflag)
                 {
-                    std::vector<Message *> * msgs = new std::vector<Message *>();
                     CommRecord * crec = NULL;
                     while (rindex < recvlist->size() && (*evt)->time >= recvlist->at(rindex)->recv_time
                            && bgn->time <= recvlist->at(rindex)->recv_time)
                     {
                         crec = recvlist->at(rindex);
-                        if (!(crec->message))
+                        if (crec->message < 0)
                         {
-                            crec->message = new Message(crec->send_time,
+                            crec->message = makeMessage(crec->send_time,
                                                         crec->recv_time,
                                                         crec->group);
-                            crec->message->tag = crec->tag;
-                            crec->message->size = crec->size;
-                            crec->message->setID(globalMessageID++);
+                            trace->messages->at(crec->message).tag = crec->tag;
+                            trace->messages->at(crec->message).size = crec->size;
                         }
-                        msgs->push_back(crec->message);
+                        event_msgs.push_back(crec->message);
                         rindex++;
                     }
-                    msgs->at(0)->receiver = new P2PEvent(bgn->time, (*evt)->time,
-                                                         bgn->value,
-                                                         bgn->entity, bgn->entity, phase,
-                                                         msgs);
+                    P2PEvent * receiver = trace->arena->make<P2PEvent>(bgn->time, (*evt)->time,
+                                                                       bgn->value,
+                                                                       bgn->entity, bgn->entity, phase);
+                    initEvent(receiver, bgn->children.size());
 
                     if (!rawtrace->phylanx)
-                        msgs->at(0)->receiver->setID(globalID++);
-                    for (int i = 1; i < msgs->size(); i++)
+                        receiver->setID(globalID++);
+                    for (std::vector<unsigned long>::iterator msg = event_msgs.begin();
+                         msg != event_msgs.end(); ++msg)
                     {
-                        msgs->at(i)->receiver = msgs->at(0)->receiver;
+                        trace->messages->at(*msg).setReceiver(bgn->entity, index);
                     }
-                    msgs->at(0)->receiver->is_recv = true;
+                    receiver->is_recv = true;
 
-                    msgs->at(0)->receiver->comm_prev = prev;
+                    receiver->comm_prev = prev;
                     if (prev)
-                        prev->comm_next = msgs->at(0)->receiver;
-                    prev = msgs->at(0)->receiver;
+                        prev->comm_next = receiver;
+                    prev = receiver;
 
-                    counter_index = advanceCounters(msgs->at(0)->receiver,
+                    counter_index = advanceCounters(receiver,
                                                     counterstack,
                                                     counters, counter_index,
                                                     lastcounters);
 
-                    e = msgs->at(0)->receiver;     
+                    e = receiver;     
                 }
                 else // Non-com event
                 {
-                    e = new Event(bgn->time, (*evt)->time, bgn->value,
-                                  bgn->entity, bgn->entity);
+                    e = trace->arena->make<Event>(bgn->time, (*evt)->time, bgn->value,
+                                                  bgn->entity, bgn->entity);
+                    initEvent(e, bgn->children.size());
 
                     e->setID(globalID++);
                     if (rawtrace->phylanx)
                     {
                         e->setGUID(bgn->guid);
                         e->setParentGUID(bgn->parent_guid);
-                        if (trace->guidMap->find(e->getGUID()) == trace->guidMap->end())
-                        {
-                            trace->guidMap->insert(
-                                std::pair<uint64_t, 
-                                          std::vector<unsigned long long> *>(
-                                              e->getGUID(),
-                                              new std::vector<unsigned long long>())
-                                                  );
-                                                    
-                        }
-                        trace->guidMap->at(e->getGUID())->push_back(e->id);
                     }
 
 
@@ -598,24 +616,12 @@ void OTFConverter::matchEvents()
                 }
 
                 e->addMetric("Function Count", 1);
+                e->index = index;
                 (*(trace->events))[(*evt)->entity]->push_back(e);
+                message_list->insert(message_list->end(), event_msgs.begin(), event_msgs.end());
+                message_offsets->push_back(message_list->size());
 
-                Function * fxn = trace->functions->at(e->function);
-                fxn->count += 1;
-                unsigned long long task_length = e->exit - e->enter;
-                fxn->task_lengths.push_back(task_length);
-                if (task_length > trace->max_task_length)
-                {
-                    trace->max_task_length = task_length;
-                    /*
-                    std::cout << "mask task length is now " << trace->max_task_length << 
-                        " from " << fxn->name.c_str() << std::endl;
-                    */
-                }
-                if (task_length > trace->functions->at(e->function)->max_length)
-                {
-                    trace->functions->at(e->function)->max_length = task_length;
-                }
+                addTaskLength(e->function, e->exit - e->enter);
             }
             else // Begin a subroutine
             {
@@ -651,8 +657,9 @@ void OTFConverter::matchEvents()
             EventRecord * bgn = stack->top();
             stack->pop();
             endtime = std::max(endtime, bgn->time);
-            Event * e = new Event(bgn->time, endtime, bgn->value,
-                          bgn->entity, bgn->entity);
+            Event * e = trace->arena->make<Event>(bgn->time, endtime, bgn->value,
+                                                  bgn->entity, bgn->entity);
+            initEvent(e, bgn->children.size());
             e->setID(globalID++);
             e->addMetric("Function Count", 1);
             if (!stack->empty())
@@ -665,7 +672,9 @@ void OTFConverter::matchEvents()
                 e->callees->push_back(*child);
                 (*child)->caller = e;
             }
+            e->index = (*(trace->events))[bgn->entity]->size();
             (*(trace->events))[bgn->entity]->push_back(e);
+            message_offsets->push_back(message_list->size());
             depth--;
         }
 
@@ -674,25 +683,170 @@ void OTFConverter::matchEvents()
             stack->pop();
     }
     delete stack;
+}    
+
+void OTFConverter::addTaskLength(int function, unsigned long long task_length)
+{
+    Function * fxn = trace->functions->at(function);
+    fxn->count += 1;
+    fxn->task_lengths.push_back(task_length);
+    if (task_length > trace->max_task_length)
+    {
+        trace->max_task_length = task_length;
+        /*
+        std::cout << "mask task length is now " << trace->max_task_length << 
+            " from " << StringPool::get(fxn->name).c_str() << std::endl;
+        */
+    }
+    if (task_length > fxn->max_length)
+    {
+        fxn->max_length = task_length;
+    }
+}
+
+static bool hasMatchedRecords(std::vector<GUIDRecord *> * records)
+{
+    if (!records)
+        return false;
+    for (std::vector<GUIDRecord *>::iterator gitr = records->begin();
+         gitr != records->end(); ++gitr)
+    {
+        if ((*gitr)->matched)
+            return true;
+    }
+    return false;
+}
+
+// With options->coalesceSpan set, a childless call without messages that
+// follows a sibling of the same function after a short gap, both no
+// longer than the span, is folded into that sibling rather than becoming
+// its own event. The sibling then covers the whole run and carries the
+// call count and total, min and max duration as metrics. The individual
+// calls can be recovered by loading the trace without coalescing.
+bool OTFConverter::coalesce(EventRecord * bgn, EventRecord * end, EventRecord * parent)
+{
+    unsigned long long span = options ? options->coalesceSpan : 0;
+    if (span == 0 || !bgn->children.empty())
+        return false;
+
+    unsigned long long duration = end->time - bgn->time;
+    if (duration > span)
+        return false;
+
+    if (rawtrace->phylanx && ((bgn->from_cr && bgn->from_cr->matched)
+                              || hasMatchedRecords(bgn->to_crs)
+                              || hasMatchedRecords(end->to_crs)))
+    {
+        return false;
+    }
+
+    // The previous sibling has to be the last event on this entity
+    std::vector<Event *> * entity_events = trace->events->at(bgn->entity);
+    Event * sibling = NULL;
+    if (parent)
+    {
+        if (!parent->children.empty())
+            sibling = parent->children.back();
+    }
+    else if (!trace->roots->at(bgn->entity)->empty())
+    {
+        sibling = trace->roots->at(bgn->entity)->back();
+    }
+    if (!sibling || entity_events->empty() || entity_events->back() != sibling
+        || sibling->function != static_cast<int>(bgn->value)
+        || !sibling->callees->empty() || sibling->exit > bgn->time
+        || bgn->time - sibling->exit > span)
+    {
+        return false;
+    }
+
+    // A call running as its own task keeps its event, whatever the kind of
+    // trace, so the task can still be found by its GUID
+    if (bgn->guid != 0 && (bgn->guid != sibling->guid || bgn->parent_guid != sibling->parent_guid))
+        return false;
+
+    // Only plain calls: no collectives, no messages
+    std::vector<unsigned long> * offsets = trace->message_offsets->at(bgn->entity);
+    if (sibling->isCollective() || offsets->at(sibling->index) != offsets->at(sibling->index + 1))
+        return false;
+
+    Metrics * metrics = sibling->metrics;
+    if (!metrics->hasMetric("Coalesced Total"))
+    {
+        unsigned long long sibling_duration = sibling->exit - sibling->enter;
+        if (sibling_duration > span)
+            return false;
+        metrics->setMetric("Coalesced Total", sibling_duration);
+        metrics->setMetric("Coalesced Min", sibling_duration);
+        metrics->setMetric("Coalesced Max", sibling_duration);
+    }
+    metrics->setMetric("Function Count", metrics->getMetric("Function Count") + 1);
+    metrics->setMetric("Coalesced Total", metrics->getMetric("Coalesced Total") + duration);
+    metrics->setMetric("Coalesced Min", std::min(metrics->getMetric("Coalesced Min"),
+                                                 static_cast<double>(duration)));
+    metrics->setMetric("Coalesced Max", std::max(metrics->getMetric("Coalesced Max"),
+                                                 static_cast<double>(duration)));
+    sibling->exit = end->time;
+    return true;
+}
+
+// Events come from the trace arena, so their callee list and metrics
+// are placed there too
+void OTFConverter::initEvent(Event * e, size_t num_callees)
+{
+    e->callees = trace->arena->make<Event::CalleeList>(ArenaAllocator<Event *>(trace->arena));
+    e->callees->reserve(num_callees);
+    e->metrics = trace->arena->make<Metrics>(trace->metrics, trace->arena);
+}
+
+bool OTFConverter::MessageOrderLessThan::operator()(unsigned long m1,
+                                                   unsigned long m2) const
+{
+    return messages->at(m1).sendtime < messages->at(m2).sendtime;
+}
+
+// Append a message to the trace store, returning its index
+long OTFConverter::makeMessage(unsigned long long send, unsigned long long recv,
+                               int group)
+{
+    trace->messages->push_back(Message(send, recv, group));
+    trace->messages->back().setID(globalMessageID++);
+    return trace->messages->size() - 1;
+}
+
+// Messages are created in matching order. Sort the store by send time
+// so window queries can scan it directly, then remap the per-entity
+// message lists to the new positions.
+void OTFConverter::sortMessages()
+{
+    std::vector<Message> * messages = trace->messages;
+    std::vector<unsigned long> order(messages->size());
+    for (unsigned long i = 0; i < order.size(); i++)
+        order[i] = i;
+    std::stable_sort(order.begin(), order.end(), MessageOrderLessThan(messages));
+
+    std::vector<unsigned long> position(order.size());
+    std::vector<Message> * sorted = new std::vector<Message>();
+    sorted->reserve(order.size());
+    for (unsigned long i = 0; i < order.size(); i++)
+    {
+        position[order[i]] = i;
+        sorted->push_back(messages->at(order[i]));
+    }
+    delete messages;
+    trace->messages = sorted;
 
-    // DEBUG: Print out continued GUIDs
-    /*
-    for (std::map<uint64_t, std::vector<unsigned long long> *>::iterator itr 
-        = trace->guidMap->begin(); itr != trace->guidMap->end(); ++itr)
+    for (std::vector<std::vector<unsigned long> *>::iterator list
+         = trace->message_lists->begin();
+         list != trace->message_lists->end(); ++list)
     {
-        if (itr->second->size() > 1)
+        for (std::vector<unsigned long>::iterator msg = (*list)->begin();
+             msg != (*list)->end(); ++msg)
         {
-            std::cout << "GUID: " << itr->first << ", IDs: ";
-            for (std::vector<unsigned long long>::iterator eitr
-                = itr->second->begin(); eitr != itr->second->end(); ++eitr)
-            {
-                std::cout << (*eitr) << ", ";
-            }
-            std::cout << std::endl;
+            *msg = position[*msg];
         }
     }
-    */
-}    
+}
 
 // We only do this with comm events right now, so we know we won't have nesting
 int OTFConverter::advanceCounters(CommEvent * evt, std::stack<CounterRecord *> * counterstack,
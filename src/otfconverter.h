@@ -13,6 +13,9 @@ class Trace;
 class CommEvent;
 class CounterRecord;
 class EventRecord;
+class OTFImportOptions;
+class Event;
+class Message;
 
 // Uses the raw records read from the OTF:
 // - switches point events into durational events
@@ -24,13 +27,20 @@ public:
     OTFConverter();
     ~OTFConverter();
 
-    Trace * importOTF(std::string filename, bool _logging);
-    Trace * importOTF2(std::string filename, bool _logging);
+    Trace * importOTF(std::string filename, OTFImportOptions * _options,
+                      bool _logging);
+    Trace * importOTF2(std::string filename, OTFImportOptions * _options,
+                       bool _logging);
 
 private:
     void convert();
     void matchEvents();
     void matchEventsSaved();
+    bool coalesce(EventRecord * bgn, EventRecord * end, EventRecord * parent);
+    void addTaskLength(int function, unsigned long long task_length);
+    void initEvent(Event * e, size_t num_callees);
+    long makeMessage(unsigned long long send, unsigned long long recv, int group);
+    void sortMessages();
     void makeSingletonPartition(CommEvent * evt);
     void addToSavedPartition(CommEvent * evt, int partition);
     void handleSavedAttributes(CommEvent * evt, EventRecord *er);
@@ -40,6 +50,7 @@ private:
 
     RawTrace * rawtrace;
     Trace * trace;
+    OTFImportOptions * options;
     int max_depth;
     unsigned long long globalID;
     unsigned long long globalMessageID;
@@ -49,6 +60,13 @@ private:
     int finalizeFunction;
     bool logging;
 
+    // Orders message store positions by the send time of their message
+    struct MessageOrderLessThan {
+        MessageOrderLessThan(std::vector<Message> * _messages) : messages(_messages) {}
+        bool operator()(unsigned long m1, unsigned long m2) const;
+        std::vector<Message> * messages;
+    };
+
     static const int event_match_portion = 24;
     static const int message_match_portion = 0;
     static const std::string collectives_string;
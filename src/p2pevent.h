@@ -7,8 +7,7 @@ class P2PEvent : public CommEvent
 {
 public:
     P2PEvent(unsigned long long _enter, unsigned long long _exit,
-             int _function, int _entity, int _pe, int _phase,
-             std::vector<Message *> * _messages = NULL);
+             int _function, int _entity, int _pe, int _phase);
     ~P2PEvent();
 
     // Based on enter time, add_order & receive-ness
@@ -25,12 +24,8 @@ public:
 
     CommEvent * compare_to_sender(CommEvent * prev);
 
-    std::vector<Message *> * getMessages() { return messages; }
-
-
-    // Messages involved wiht this event
-    std::vector<Message *> * messages;
-
+    // Messages involved with this event are found through the
+    // Trace::message_offsets CSR layout rather than stored here
     bool is_recv;
 };
 
@@ -1,7 +1,7 @@
 #include "primaryentitygroup.h"
 #include "entity.h"
 
-PrimaryEntityGroup::PrimaryEntityGroup(int _id, std::string _name)
+PrimaryEntityGroup::PrimaryEntityGroup(int _id, StringPool::Handle _name)
     : id(_id),
       name(_name),
       entities(new std::vector<Entity *>())
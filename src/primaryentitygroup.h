@@ -2,7 +2,7 @@
 #define PRIMARYENTITYGROUP_H
 
 #include <vector>
-#include <string>
+#include "stringpool.h"
 
 class Entity;
 
@@ -12,11 +12,11 @@ class Entity;
 class PrimaryEntityGroup
 {
 public:
-    PrimaryEntityGroup(int _id, std::string _name);
+    PrimaryEntityGroup(int _id, StringPool::Handle _name);
     ~PrimaryEntityGroup();
 
     int id;
-    std::string name;
+    StringPool::Handle name;
 
     // This order is important for communicator rank ID
     std::vector<Entity *> * entities;
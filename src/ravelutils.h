@@ -3,6 +3,8 @@
 
 #include <string>
 #include <iostream>
+#include <vector>
+#include <thread>
 
 // For qSorting lists of pointers
 template<class T>
@@ -53,6 +55,38 @@ public:
         std::cout << hours << " hours" << std::endl;
         return;
     }
+
+    // Run body(i) for every i in [begin, end) on all hardware threads.
+    // Iterations are dealt out round robin and must be independent.
+    template <typename Body>
+    static void parallelFor(unsigned long begin, unsigned long end, Body body)
+    {
+        unsigned long workers = std::thread::hardware_concurrency();
+        if (workers == 0)
+            workers = 1;
+        if (workers > end - begin)
+            workers = end - begin;
+        if (workers <= 1)
+        {
+            for (unsigned long i = begin; i < end; i++)
+                body(i);
+            return;
+        }
+
+        std::vector<std::thread> threads = std::vector<std::thread>();
+        for (unsigned long w = 0; w < workers; w++)
+        {
+            threads.push_back(std::thread([=]() {
+                for (unsigned long i = begin + w; i < end; i += workers)
+                    body(i);
+            }));
+        }
+        for (std::vector<std::thread>::iterator thread = threads.begin();
+             thread != threads.end(); ++thread)
+        {
+            thread->join();
+        }
+    }
 };
 
 #endif // RAVEL_UTIL_H
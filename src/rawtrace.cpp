@@ -16,6 +16,7 @@
 RawTrace::RawTrace(int nt, int np)
     : primaries(NULL),
       processingElements(NULL),
+      system_tree(NULL),
       functionGroups(NULL),
       functions(NULL),
       events(NULL),
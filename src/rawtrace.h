@@ -15,6 +15,7 @@ class Function;
 class Counter;
 class CounterRecord;
 class EventRecord;
+class SystemNode;
 
 // Trace from OTF without processing
 class RawTrace
@@ -34,6 +35,7 @@ public:
 
     std::map<int, PrimaryEntityGroup *> * primaries;
     PrimaryEntityGroup * processingElements;
+    std::vector<SystemNode *> * system_tree; // Passed to the processed trace
     std::map<int, std::string> * functionGroups;
     std::map<int, Function *> * functions;
     std::vector<std::vector<EventRecord *> *> * events;
@@ -0,0 +1,98 @@
+#include "rowtable.h"
+#include "event.h"
+#include "ravelutils.h"
+#include <algorithm>
+#include <cmath>
+
+RowTable::RowTable(unsigned long long _start, unsigned long long _bin_width,
+                   unsigned long _bins)
+    : start(_start),
+      bin_width(_bin_width),
+      bins(_bins),
+      entities(0),
+      busy_totals(std::vector<uint32_t>()),
+      count_totals(std::vector<uint32_t>()),
+      functions(std::vector<int>())
+{
+}
+
+// Self spans of one entity are disjoint, so over all of them this is
+// linear in the number of spans plus bins
+void RowTable::addSelfSpan(int function, unsigned long long enter, unsigned long long exit,
+                           std::vector<unsigned long long>& busy_ticks, std::vector<Share>& shares)
+{
+    enter = std::max(enter, start);
+    Share share;
+    share.function = function;
+    for (share.bin = (enter - start) / bin_width; enter < exit && share.bin < bins; share.bin++)
+    {
+        unsigned long long boundary = start + (share.bin + 1) * bin_width;
+        share.busy = std::min(exit, boundary) - enter;
+        busy_ticks[share.bin] += share.busy;
+        shares.push_back(share);
+        enter = boundary;
+    }
+}
+
+void RowTable::build(std::vector<std::vector<Event *> *> * events)
+{
+    entities = events->size();
+    busy_totals.assign(entities * (bins + 1), 0);
+    count_totals.assign(entities * (bins + 1), 0);
+    functions.assign(entities * bins, -1);
+    RavelUtils::parallelFor(0, entities, [this, events](unsigned long entity) {
+        std::vector<unsigned long long> busy_ticks(bins, 0);
+        std::vector<Share> shares = std::vector<Share>();
+        uint32_t * counts = &count_totals[entity * (bins + 1)];
+        for (std::vector<Event *>::iterator evt = events->at(entity)->begin();
+             evt != events->at(entity)->end(); ++evt)
+        {
+            Event * e = *evt;
+            if (e->depth < 0 || e->exit <= start)
+                continue;
+            if (e->enter >= start)
+                counts[std::min((e->enter - start) / bin_width,
+                                static_cast<unsigned long long>(bins - 1)) + 1]++;
+
+            // Time outside its callees
+            unsigned long long enter = e->enter;
+            for (Event::CalleeList::iterator child = e->callees->begin();
+                 child != e->callees->end(); ++child)
+            {
+                if ((*child)->enter > enter)
+                    addSelfSpan(e->function, enter, (*child)->enter, busy_ticks, shares);
+                enter = std::max(enter, (*child)->exit);
+            }
+            if (e->exit > enter)
+                addSelfSpan(e->function, enter, e->exit, busy_ticks, shares);
+        }
+
+        std::sort(shares.begin(), shares.end(), shareLessThan);
+        // Each bin's function with the most self time
+        unsigned long long most = 0;
+        std::vector<Share>::iterator share = shares.begin();
+        while (share != shares.end())
+        {
+            Share total = *share;
+            for (++share; share != shares.end() && share->bin == total.bin
+                          && share->function == total.function; ++share)
+            {
+                total.busy += share->busy;
+            }
+            int& function = functions[entity * bins + total.bin];
+            if (function < 0 || total.busy > most)
+            {
+                function = total.function;
+                most = total.busy;
+            }
+        }
+
+        uint32_t * totals = &busy_totals[entity * (bins + 1)];
+        for (unsigned long bin = 0; bin < bins; bin++)
+        {
+            totals[bin + 1] = totals[bin]
+                              + static_cast<uint32_t>(round(scale * busy_ticks[bin] / static_cast<double>(bin_width)));
+            counts[bin + 1] += counts[bin];
+        }
+    });
+}
@@ -0,0 +1,73 @@
+#ifndef ROWTABLE_H
+#define ROWTABLE_H
+
+#include <vector>
+#include <stdint.h>
+
+class Event;
+
+// Summaries of every entity over fixed width bins from start, for views
+// that merge adjacent entities into one row. Busy time, as fixed point
+// fractions of a bin, and events entering are kept as running totals, so
+// any stretch of whole bins takes two lookups per entity. Each bin also
+// keeps the function with the most self time in it.
+class RowTable
+{
+public:
+    RowTable(unsigned long long _start, unsigned long long _bin_width,
+             unsigned long _bins);
+
+    // Entities are filled in parallel, callee lists sorted by enter
+    void build(std::vector<std::vector<Event *> *> * events);
+
+    // Busy time of bins first up to last, scale for each wholly busy bin
+    unsigned long long busy(unsigned long entity, unsigned long first, unsigned long last) const
+    {
+        const uint32_t * totals = &busy_totals[entity * (bins + 1)];
+        return totals[last] - totals[first];
+    }
+
+    // Events entering in bins first up to last
+    unsigned long long count(unsigned long entity, unsigned long first, unsigned long last) const
+    {
+        const uint32_t * totals = &count_totals[entity * (bins + 1)];
+        return totals[last] - totals[first];
+    }
+
+    // Function with the most self time in a bin, -1 if none
+    int function(unsigned long entity, unsigned long bin) const
+    {
+        return functions[entity * bins + bin];
+    }
+
+    unsigned long long start;
+    unsigned long long bin_width;
+    unsigned long bins;
+
+    static const uint32_t scale = 65535; // A wholly busy bin
+
+private:
+    // Self time of a function in a bin while building
+    struct Share {
+        unsigned long bin;
+        int function;
+        unsigned long long busy;
+    };
+
+    static bool shareLessThan(const Share& s1, const Share& s2)
+    {
+        if (s1.bin != s2.bin)
+            return s1.bin < s2.bin;
+        return s1.function < s2.function;
+    }
+
+    void addSelfSpan(int function, unsigned long long enter, unsigned long long exit,
+                     std::vector<unsigned long long>& busy_ticks, std::vector<Share>& shares);
+
+    unsigned long entities;
+    std::vector<uint32_t> busy_totals; // bins + 1 per entity
+    std::vector<uint32_t> count_totals; // bins + 1 per entity
+    std::vector<int> functions; // bins per entity
+};
+
+#endif // ROWTABLE_H
@@ -0,0 +1,33 @@
+#include "stringpool.h"
+
+StringPool::StringPool()
+    : handles(std::unordered_map<std::string, Handle>()),
+      strings(std::vector<const std::string *>())
+{
+    strings.push_back(&handles.insert(std::make_pair(std::string(), 0)).first->first);
+}
+
+StringPool& StringPool::instance()
+{
+    static StringPool pool;
+    return pool;
+}
+
+StringPool::Handle StringPool::intern(const std::string& str)
+{
+    StringPool& pool = instance();
+    std::pair<std::unordered_map<std::string, Handle>::iterator, bool> result
+            = pool.handles.insert(std::make_pair(str, static_cast<Handle>(pool.strings.size())));
+    // Node-based map, so the key's address is stable across rehashes
+    if (result.second)
+        pool.strings.push_back(&result.first->first);
+    return result.first->second;
+}
+
+void StringPool::clear()
+{
+    StringPool& pool = instance();
+    std::unordered_map<std::string, Handle>().swap(pool.handles);
+    std::vector<const std::string *>().swap(pool.strings);
+    pool.strings.push_back(&pool.handles.insert(std::make_pair(std::string(), 0)).first->first);
+}
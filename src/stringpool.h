@@ -0,0 +1,38 @@
+#ifndef STRINGPOOL_H
+#define STRINGPOOL_H
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+// Process-wide table of the names read from trace definitions. Each
+// distinct string is stored once and referred to by a small integer
+// handle, so functions, entities, groups and collectives that share a name
+// share its storage. Strings are only added while a trace is loaded, so a
+// handle and the reference returned by get() stay valid until the pool is
+// cleared for the next trace. Handle 0 is always the empty string.
+class StringPool
+{
+public:
+    typedef unsigned int Handle;
+
+    static Handle intern(const std::string& str);
+    static const std::string& get(Handle handle) { return *instance().strings[handle]; }
+
+    static unsigned long size() { return instance().strings.size(); }
+
+    // Drop every string but the empty one. Only once nothing holds a handle.
+    static void clear();
+
+private:
+    StringPool();
+    StringPool(const StringPool&);
+    StringPool& operator=(const StringPool&);
+
+    static StringPool& instance();
+
+    std::unordered_map<std::string, Handle> handles;
+    std::vector<const std::string *> strings; // Keys of handles, by handle
+};
+
+#endif // STRINGPOOL_H
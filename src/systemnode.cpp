@@ -0,0 +1,56 @@
+#include "systemnode.h"
+
+SystemNode::SystemNode(unsigned long _id, StringPool::Handle _name,
+                       StringPool::Handle _class_name, long _parent)
+    : id(_id),
+      name(_name),
+      class_name(_class_name),
+      parent(_parent),
+      entity(-1),
+      children(new std::vector<unsigned long>()),
+      entities(0),
+      busy(0),
+      messages(0),
+      message_bytes(0),
+      function(-1),
+      function_time(NULL)
+{
+}
+
+SystemNode::~SystemNode()
+{
+    delete children;
+    delete function_time;
+}
+
+void to_json(json& j, const SystemNode& n)
+{
+    j = json{
+        {"id", n.id},
+        {"name", StringPool::get(n.name)},
+        {"class", StringPool::get(n.class_name)},
+        {"entity", n.entity},
+        {"children", n.children->size()},
+        {"entities", n.entities},
+        {"busy", n.busy},
+        {"messages", n.messages},
+        {"message_bytes", n.message_bytes},
+        {"function", n.function}
+    };
+}
+
+void to_json(json& j, const SystemNode * n)
+{
+    j = json{
+        {"id", n->id},
+        {"name", StringPool::get(n->name)},
+        {"class", StringPool::get(n->class_name)},
+        {"entity", n->entity},
+        {"children", n->children->size()},
+        {"entities", n->entities},
+        {"busy", n->busy},
+        {"messages", n->messages},
+        {"message_bytes", n->message_bytes},
+        {"function", n->function}
+    };
+}
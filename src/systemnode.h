@@ -0,0 +1,42 @@
+#ifndef SYSTEMNODE_H
+#define SYSTEMNODE_H
+
+#include <vector>
+#include <utility>
+#include <nlohmann/json.hpp>
+#include "stringpool.h"
+
+using json = nlohmann::json;
+
+// One level of the machine hierarchy: a node of the OTF2 system tree
+// (machine, node), a location group (process, locality) or, at the
+// leaves, an entity. Totals are rolled up from the leaves by the Trace.
+class SystemNode
+{
+public:
+    SystemNode(unsigned long _id, StringPool::Handle _name,
+               StringPool::Handle _class_name, long _parent);
+    ~SystemNode();
+
+    unsigned long id; // Position in Trace::system_tree
+    StringPool::Handle name;
+    StringPool::Handle class_name;
+    long parent; // -1 at the top
+    long entity; // Entity at a leaf, -1 otherwise
+    std::vector<unsigned long> * children;
+
+    // Over the entities beneath
+    unsigned long entities;
+    unsigned long long busy;
+    unsigned long long messages; // Sent
+    unsigned long long message_bytes;
+    int function; // Most self time, -1 if none
+
+    // Self time by function, sorted by function. Only kept while rolling up.
+    std::vector<std::pair<int, unsigned long long> > * function_time;
+};
+
+void to_json(json& j, const SystemNode& n);
+void to_json(json& j, const SystemNode * n);
+
+#endif // SYSTEMNODE_H
@@ -6,6 +6,9 @@
 #include <climits>
 #include <cfloat>
 #include <algorithm>
+#include <queue>
+#include <unordered_map>
+#include <regex>
 
 #include "entity.h"
 #include "event.h"
@@ -19,6 +22,23 @@
 #include "primaryentitygroup.h"
 #include "metrics.h"
 #include "message.h"
+#include "eventcolumns.h"
+#include "lodpyramid.h"
+#include "busyprofile.h"
+#include "systemnode.h"
+#include "occurrenceindex.h"
+#include "functionprofile.h"
+#include "callingcontexttree.h"
+#include "histogramtree.h"
+#include "imbalancetable.h"
+#include "functionbusytable.h"
+#include "rowtable.h"
+#include "messagestats.h"
+#include "gapindex.h"
+
+// Limits passed to std::min by reference need a definition
+const unsigned long Trace::max_search_limit;
+const unsigned long Trace::max_gap_limit;
 
 Trace::Trace(int nt, int np)
     : name(""),
@@ -28,25 +48,66 @@ Trace::Trace(int nt, int np)
       units(-9),
       max_depth(0),
       totalTime(0), // for paper timing
+      arena(new Arena()),
       metrics(new std::vector<std::string>()),
       metric_units(new std::map<std::string, std::string>()),
       functionGroups(new std::map<int, std::string>()),
       functions(new std::map<int, Function *>()),
       primaries(NULL),
       processingElements(NULL),
+      system_tree(NULL),
       entitygroups(NULL),
       collective_definitions(NULL),
       collectives(NULL),
       collectiveMap(NULL),
       events(new std::vector<std::vector<Event *> *>(std::max(nt, np))),
       roots(new std::vector<std::vector<Event *> *>(std::max(nt, np))),
-      guidMap(new std::map<uint64_t, std::vector<unsigned long long> *>()),
+      event_offsets(new std::vector<unsigned long>()),
+      messages(new std::vector<Message>()),
+      message_offsets(new std::vector<std::vector<unsigned long> *>(std::max(nt, np))),
+      message_lists(new std::vector<std::vector<unsigned long> *>(std::max(nt, np))),
+      message_entity_offsets(new std::vector<unsigned long>()),
+      message_entity_list(new std::vector<unsigned long>()),
+      message_reach(new std::vector<unsigned long long>()),
+      message_stats(new MessageStats()),
+      critical_path(new std::vector<Event *>()),
+      critical_reach(new std::vector<unsigned long long>()),
+      critical_floor(new std::vector<unsigned long long>()),
+      event_columns(NULL),
+      lod(new std::vector<LODPyramid *>()),
+      lod_shift(0),
+      lod_levels(0),
+      row_table(NULL),
+      occurrences(new OccurrenceIndex()),
+      longest(new std::vector<LongestTasks::Task>()),
+      longest_by_function(new std::map<int, std::vector<LongestTasks::Task> >()),
+      longest_tasks(new std::vector<LongestTasks *>()),
+      longest_calls(new LongestTasks()),
+      function_profiles(new std::vector<FunctionProfile *>()),
+      self_times(new std::vector<unsigned long long>()),
+      wait_times(new std::vector<unsigned long long>()),
+      wait_kinds(new std::vector<unsigned char>()),
+      contexts(new CallingContextTree()),
+      length_histograms(new HistogramTree()),
+      idle_gaps(new GapIndex()),
+      utilization(NULL),
+      function_utilization(NULL),
+      imbalance(NULL),
+      comm_enters(new std::vector<unsigned long long>()),
+      comm_exits(new std::vector<unsigned long long>()),
+      guid_slots(new std::unordered_map<uint64_t, unsigned long>()),
+      guid_offsets(new std::vector<unsigned long>()),
+      guid_events(new std::vector<EventLocation>()),
+      parent_slots(new std::unordered_map<uint64_t, unsigned long>()),
+      child_offsets(new std::vector<unsigned long>()),
+      child_guids(new std::vector<uint64_t>()),
       function_list(new std::vector<Function *>()),
       mpi_group(-1),
       max_time(0),
       min_time(ULLONG_MAX),
       max_task_length(0),
-      isProcessed(false)
+      isProcessed(false),
+      traceback_visited(new std::vector<bool>())
 {
     for (int i = 0; i < std::max(nt, np); i++) {
         (*events)[i] = new std::vector<Event *>();
@@ -56,6 +117,12 @@ Trace::Trace(int nt, int np)
     {
         (*roots)[i] = new std::vector<Event *>();
     }
+
+    for (int i = 0; i < std::max(nt, np); i++)
+    {
+        (*message_offsets)[i] = new std::vector<unsigned long>(1, 0);
+        (*message_lists)[i] = new std::vector<unsigned long>();
+    }
 }
 
 Trace::~Trace()
@@ -71,22 +138,17 @@ Trace::~Trace()
         itr->second = NULL;
     }
     delete functions;
+    delete function_list;
 
+    // Events themselves are in the arena
     for (std::vector<std::vector<Event *> *>::iterator eitr = events->begin();
          eitr != events->end(); ++eitr)
     {
-        for (std::vector<Event *>::iterator itr = (*eitr)->begin();
-             itr != (*eitr)->end(); ++itr)
-        {
-            delete *itr;
-            *itr = NULL;
-        }
         delete *eitr;
         *eitr = NULL;
     }
     delete events;
 
-    // Don't need to delete Events, they were deleted above
     for (std::vector<std::vector<Event *> *>::iterator eitr = roots->begin();
          eitr != roots->end(); ++eitr)
     {
@@ -94,6 +156,77 @@ Trace::~Trace()
         *eitr = NULL;
     }
     delete roots;
+    delete event_offsets;
+    delete traceback_visited;
+
+    delete messages;
+    delete message_entity_offsets;
+    delete message_entity_list;
+    delete message_reach;
+    delete message_stats;
+    delete critical_path;
+    delete critical_reach;
+    delete critical_floor;
+    for (unsigned long i = 0; i < message_offsets->size(); i++)
+    {
+        delete message_offsets->at(i);
+        delete message_lists->at(i);
+    }
+    delete message_offsets;
+    delete message_lists;
+
+    if (event_columns)
+    {
+        for (std::vector<EventColumns *>::iterator columns = event_columns->begin();
+             columns != event_columns->end(); ++columns)
+        {
+            delete *columns;
+        }
+        delete event_columns;
+    }
+
+    for (std::vector<LODPyramid *>::iterator pyramid = lod->begin();
+         pyramid != lod->end(); ++pyramid)
+    {
+        delete *pyramid;
+    }
+    delete lod;
+    delete row_table;
+    delete occurrences;
+    delete longest;
+    delete longest_by_function;
+    for (std::vector<LongestTasks *>::iterator tasks = longest_tasks->begin();
+         tasks != longest_tasks->end(); ++tasks)
+    {
+        delete *tasks;
+    }
+    delete longest_tasks;
+    delete longest_calls;
+    for (std::vector<FunctionProfile *>::iterator profile = function_profiles->begin();
+         profile != function_profiles->end(); ++profile)
+    {
+        delete *profile;
+    }
+    delete function_profiles;
+    delete self_times;
+    delete wait_times;
+    delete wait_kinds;
+    delete contexts;
+    delete length_histograms;
+    delete idle_gaps;
+
+    delete utilization;
+    delete imbalance;
+    delete function_utilization;
+    delete comm_enters;
+    delete comm_exits;
+
+    delete guid_slots;
+    delete guid_offsets;
+    delete guid_events;
+    delete parent_slots;
+    delete child_offsets;
+    delete child_guids;
 
     for (std::map<int, EntityGroup *>::iterator comm = entitygroups->begin();
          comm != entitygroups->end(); ++comm)
@@ -133,566 +266,2459 @@ Trace::~Trace()
         delete primary->second;
     }
     delete primaries;
-    
-    for (std::map<uint64_t, std::vector<unsigned long long> *>::iterator itr 
-        = guidMap->begin(); itr != guidMap->end(); ++itr)
+
+    if (system_tree)
     {
-        delete (itr->second);
-        itr->second = NULL;
+        for (std::vector<SystemNode *>::iterator node = system_tree->begin();
+             node != system_tree->end(); ++node)
+        {
+            delete *node;
+        }
+        delete system_tree;
     }
-    delete guidMap;
+
+    // Releases all events, their callee lists and metrics at once
+    delete arena;
 }
 
 void Trace::preprocess()
 {
+    indexCallTrees();
+    indexSelfTimes();
+    contexts->build(events, roots, event_offsets, self_times);
+    indexMessages();
+    indexWaitStates();
+    message_stats->build(messages, events->size());
+    indexGUIDs();
+    findCriticalPath();
+    buildPyramids();
+    occurrences->build(events);
+    rankTasks();
+    buildProfiles();
+    length_histograms->build(events, min_time, max_time, options.coalesceSpan > 0);
+    idle_gaps->build(roots, min_time, max_time);
+    buildOverviews();
+    rollUpSystemTree();
+
+    event_columns = new std::vector<EventColumns *>(events->size(), NULL);
+    RavelUtils::parallelFor(0, events->size(), [this](unsigned long entity) {
+        EventColumns * columns = new EventColumns();
+        columns->build(events->at(entity));
+        event_columns->at(entity) = columns;
+    });
+
     isProcessed = true;
 }
 
-// Find the smallest event in a timeline that contains the given time
-Event * Trace::findEvent(int entity, unsigned long long time)
+// Self time of every event, its length less that of its callees, and
+// the total of each function. Entities are done in parallel and their
+// function totals merged after.
+void Trace::indexSelfTimes()
 {
-    if (entity < 0 || entity >= roots->size())
-        return NULL;
+    self_times->assign(event_offsets->back(), 0);
+    std::vector<std::map<int, unsigned long long> > entity_totals(events->size());
+    RavelUtils::parallelFor(0, events->size(), [this, &entity_totals](unsigned long entity) {
+        unsigned long offset = event_offsets->at(entity);
+        std::map<int, unsigned long long>& totals = entity_totals[entity];
+        for (std::vector<Event *>::iterator evt = events->at(entity)->begin();
+             evt != events->at(entity)->end(); ++evt)
+        {
+            unsigned long long callee_time = 0;
+            for (Event::CalleeList::iterator child = (*evt)->callees->begin();
+                 child != (*evt)->callees->end(); ++child)
+            {
+                callee_time += (*child)->exit - (*child)->enter;
+            }
+            unsigned long long length = (*evt)->exit - (*evt)->enter;
+            if (length > callee_time)
+            {
+                (*self_times)[offset + (*evt)->index] = length - callee_time;
+                totals[(*evt)->function] += length - callee_time;
+            }
+        }
+    });
 
-    Event * found = NULL;
-    for (std::vector<Event *>::iterator root = roots->at(entity)->begin();
-         root != roots->at(entity)->end(); ++root)
+    for (std::map<int, Function *>::iterator fxn = functions->begin();
+         fxn != functions->end(); ++fxn)
     {
-        found = (*root)->findChild(time);
-        if (found)
-            return found;
+        fxn->second->self_time = 0;
+    }
+    for (std::vector<std::map<int, unsigned long long> >::iterator totals = entity_totals.begin();
+         totals != entity_totals.end(); ++totals)
+    {
+        for (std::map<int, unsigned long long>::iterator total = totals->begin();
+             total != totals->end(); ++total)
+        {
+            functions->at(total->first)->self_time += total->second;
+        }
     }
 
-    return found;
+    if (options.rankBySelfTime)
+    {
+        std::stable_sort(function_list->begin(), function_list->end(),
+                         Function::functionSelfTimeGreaterThan);
+        int rank = 1;
+        for (std::vector<Function *>::iterator fxn = function_list->begin();
+             fxn != function_list->end(); ++fxn)
+        {
+            (*fxn)->rank = rank;
+            rank++;
+        }
+    }
 }
 
-json Trace::timeToJSON(unsigned long long start, unsigned long long stop, 
-                       unsigned long long entity_start,
-                       unsigned long long entities,
-                       unsigned long width, 
-                       unsigned long long taskid,
-                       unsigned long long task_time,
-                       unsigned long traceback_state,
-                       unsigned long long hover,
-                       bool logging)
+unsigned long long Trace::selfTime(Event * evt)
 {
-    json jo;
+    return self_times->at(event_offsets->at(evt->entity) + evt->index);
+}
 
-    jo["path"] = fullpath;
-    jo["mintime"] = last_init;
-    jo["maxtime"] = last_finalize + 10; // So the finalize has some length
-    jo["starttime"] = start;
-    jo["stoptime"] = stop;
-    jo["units"] = units;
-    jo["max_depth"] = max_depth;
-    jo["entities"] = entities;
-    jo["entity_start"] = entity_start;
-    if (start > stop || start > max_time || stop < min_time)
+// Messages are already sorted by send time, so each entity's run of them
+// is too, and with the running maximum of their receive times the ones
+// overlapping a window are a contiguous part of the run to filter
+void Trace::indexMessages()
+{
+    message_entity_offsets->assign(events->size() + 1, 0);
+    for (std::vector<Message>::iterator msg = messages->begin();
+         msg != messages->end(); ++msg)
     {
-        jo["error"] = "Incorrect time range.";
-        return jo;
+        if (!msg->hasSender() || !msg->hasReceiver())
+            continue;
+        message_entity_offsets->at(msg->sender_entity + 1)++;
+        if (msg->receiver_entity != msg->sender_entity)
+            message_entity_offsets->at(msg->receiver_entity + 1)++;
     }
+    for (unsigned long entity = 0; entity < events->size(); entity++)
+        message_entity_offsets->at(entity + 1) += message_entity_offsets->at(entity);
 
-    // Determine min_span of half a pixel in width
-    unsigned long long a_pixel = (stop - start) / width / 2;
+    message_entity_list->assign(message_entity_offsets->back(), 0);
+    message_reach->assign(message_entity_offsets->back(), 0);
+    std::vector<unsigned long> fill(message_entity_offsets->begin(), message_entity_offsets->end() - 1);
+    for (unsigned long m = 0; m < messages->size(); m++)
+    {
+        Message& msg = messages->at(m);
+        if (!msg.hasSender() || !msg.hasReceiver())
+            continue;
+        message_entity_list->at(fill[msg.sender_entity]++) = m;
+        if (msg.receiver_entity != msg.sender_entity)
+            message_entity_list->at(fill[msg.receiver_entity]++) = m;
+    }
 
-    std::set<uint64_t> event_set = std::set<uint64_t>();
-    std::vector<json> event_slice = std::vector<json>();
-    std::vector<json> msg_slice = std::vector<json>();
-    std::vector<json> collective_slice = std::vector<json>();
-    std::vector<std::vector<json> >  parent_slice
-        = std::vector<std::vector<json> >();
-    parent_slice.push_back(std::vector<json>());
-    std::map<std::string, Function *> function_names = std::map<std::string, Function *>();
+    RavelUtils::parallelFor(0, events->size(), [this](unsigned long entity) {
+        unsigned long long reach = 0;
+        for (unsigned long position = message_entity_offsets->at(entity);
+             position < message_entity_offsets->at(entity + 1); position++)
+        {
+            reach = std::max(reach, messages->at(message_entity_list->at(position)).recvtime);
+            message_reach->at(position) = reach;
+        }
+    });
+}
 
-    unsigned long long entity_stop = entity_start + entities;
-   
-    // Trace back events
-    if (taskid != 0)
+// Wait states of every comm event. A receive waits from its enter until
+// its latest sender enters, capped at its exit, a send until its latest
+// receiver enters if that is before the send exits, and a collective
+// participant until the last participant enters, capped at its exit.
+// Collectives are done in parallel, as each event is in one record, then
+// entities in parallel for messages and the function totals, which are
+// merged after.
+void Trace::indexWaitStates()
+{
+    wait_times->assign(event_offsets->back(), 0);
+    wait_kinds->assign(event_offsets->back(), 0); // wait_none
+
+    std::vector<CollectiveRecord *> records = std::vector<CollectiveRecord *>();
+    if (collectives)
     {
-        bool full_traceback = false;
-        if (traceback_state == traceback_full) {
-            full_traceback = true;
+        for (std::map<unsigned long long, CollectiveRecord *>::iterator cr = collectives->begin();
+             cr != collectives->end(); ++cr)
+        {
+            records.push_back(cr->second);
         }
-        for (unsigned long long entity = entity_start; entity < entity_stop; entity++)
+    }
+    RavelUtils::parallelFor(0, records.size(), [this, &records](unsigned long r) {
+        std::vector<CollectiveEvent *> * participants = records[r]->events;
+        unsigned long long last = 0;
+        for (std::vector<CollectiveEvent *>::iterator evt = participants->begin();
+             evt != participants->end(); ++evt)
+        {
+            last = std::max(last, (*evt)->enter);
+        }
+        for (std::vector<CollectiveEvent *>::iterator evt = participants->begin();
+             evt != participants->end(); ++evt)
+        {
+            if (last <= (*evt)->enter)
+                continue;
+            unsigned long position = event_offsets->at((*evt)->entity) + (*evt)->index;
+            (*wait_times)[position] = std::min(last, (*evt)->exit) - (*evt)->enter;
+            (*wait_kinds)[position] = wait_collective;
+        }
+    });
+
+    std::vector<std::map<int, unsigned long long> > entity_totals(events->size());
+    RavelUtils::parallelFor(0, events->size(), [this, &entity_totals](unsigned long entity) {
+        unsigned long offset = event_offsets->at(entity);
+        std::vector<unsigned long> * offsets = message_offsets->at(entity);
+        std::vector<unsigned long> * list = message_lists->at(entity);
+        std::map<int, unsigned long long>& totals = entity_totals[entity];
+        for (std::vector<Event *>::iterator evt = events->at(entity)->begin();
+             evt != events->at(entity)->end(); ++evt)
         {
-            for (std::vector<Event *>::iterator root = roots->at(entity)->begin();
-                 root != roots->at(entity)->end(); ++root)
+            unsigned long position = offset + (*evt)->index;
+            for (unsigned long m = offsets->at((*evt)->index); m < offsets->at((*evt)->index + 1); m++)
             {
-                eventTraceBackJSON(*root, start, stop, entity_start, entities,
-                                   a_pixel, taskid, task_time, full_traceback, msg_slice, 
-                                   event_slice, event_set, function_names, logging);
+                Message * msg = &(messages->at(list->at(m)));
+                unsigned long long peer_enter;
+                unsigned char kind;
+                if (msg->receivedBy(*evt) && msg->hasSender())
+                {
+                    peer_enter = events->at(msg->sender_entity)->at(msg->sender_index)->enter;
+                    kind = wait_late_sender;
+                }
+                else if (msg->sentBy(*evt) && msg->hasReceiver())
+                {
+                    peer_enter = events->at(msg->receiver_entity)->at(msg->receiver_index)->enter;
+                    kind = wait_late_receiver;
+                }
+                else
+                {
+                    continue;
+                }
+
+                if (peer_enter <= (*evt)->enter)
+                    continue;
+                // A send only waited if it was still blocked when the
+                // receive was posted, otherwise it was eager or asynchronous
+                if (kind == wait_late_receiver && peer_enter >= (*evt)->exit)
+                    continue;
+                unsigned long long wait = std::min(peer_enter, (*evt)->exit) - (*evt)->enter;
+                if (wait > (*wait_times)[position])
+                {
+                    (*wait_times)[position] = wait;
+                    (*wait_kinds)[position] = kind;
+                }
             }
+
+            if ((*wait_times)[position] > 0)
+                totals[(*evt)->function] += (*wait_times)[position];
         }
-    }
+    });
 
-    // All events
-    for (unsigned long long entity = entity_start; entity < entity_stop; entity++)
+    for (std::map<int, Function *>::iterator fxn = functions->begin();
+         fxn != functions->end(); ++fxn)
     {
-        for (std::vector<Event *>::iterator root = roots->at(entity)->begin();
-             root != roots->at(entity)->end(); ++root)
-        {
-            timeEventToJSON(*root, 0, start, stop, entity_start, entities,
-                            a_pixel, taskid, event_slice, event_set, 
-                            msg_slice, collective_slice,
-                            parent_slice, function_names);
-        }
+        fxn->second->wait_time = 0;
     }
-
-    // Should autoconvert from std::vector and std::map to json
-    jo["events"] = event_slice;
-    jo["parent_events"] = parent_slice;
-    jo["messages"] = msg_slice;
-    jo["collectives"] = collective_slice;
-    jo["functions"] = function_names;
-
-    std::vector<std::string> hover_strings = std::vector<std::string>();
-    if (hover)
+    for (std::vector<std::map<int, unsigned long long> >::iterator totals = entity_totals.begin();
+         totals != entity_totals.end(); ++totals)
     {
-        std::vector<unsigned long long> * hover_ids = guidMap->at(hover);
-        for (std::vector<unsigned long long>::iterator itr = hover_ids->begin();
-            itr != hover_ids->end(); ++itr)
+        for (std::map<int, unsigned long long>::iterator total = totals->begin();
+             total != totals->end(); ++total)
         {
-            hover_strings.push_back(std::to_string(*itr));
+            functions->at(total->first)->wait_time += total->second;
         }
     }
-    jo["hover_ids"] = hover_strings;
-
-    return jo;
 }
 
-void Trace::msgTraceBackJSON(CommEvent * evt, int depth, bool sibling, bool full_traceback, Message * last, 
-    unsigned long long start, unsigned long long stop, unsigned long long entity_start, unsigned long long entities,
-    unsigned long long min_span, std::vector<json>& msg_slice, std::vector<json>& evt_slice, 
-    std::set<uint64_t>& evt_set, std::map<std::string, Function *>& function_names, bool logging)
+// The longest tasks overall and per function, kept in bounded heaps per
+// entity in parallel and then merged, plus block summaries of each
+// entity and of each function's calls for windowed queries. An event
+// standing in for coalesced calls ranks by the longest of them.
+void Trace::rankTasks()
 {
-    if (((evt_set.find(evt->id) == evt_set.end()) && ((evt->exit - evt->enter) > min_span))
-        && (!sibling || full_traceback))
+    int rank_by = -1;
+    for (unsigned int i = 0; i < metrics->size(); i++)
     {
-        json jevt(evt);
-        jevt["depth"] = depth;
-        jevt["sibling"] = sibling;
-        evt_slice.push_back(jevt);
-        evt_set.insert(evt->id);
-
-        function_names.insert(std::pair<std::string, Function *>(std::to_string(evt->function), 
-                                                                 functions->at(evt->function)));
+        if (metrics->at(i) == "Coalesced Max")
+            rank_by = i;
     }
 
-    std::vector<Message *> * messages = evt->getMessages();
-    if (messages != NULL) {
-        for (std::vector<Message *>::iterator msg = messages->begin();
-            msg != messages->end(); ++msg)
+    typedef std::map<int, std::vector<LongestTasks::Task> > FunctionHeaps;
+    std::vector<FunctionHeaps> entity_heaps(events->size());
+    longest_tasks->assign(events->size(), NULL);
+    RavelUtils::parallelFor(0, events->size(), [this, &entity_heaps, rank_by](unsigned long entity) {
+        LongestTasks * tasks = new LongestTasks();
+        tasks->build(events->at(entity), rank_by);
+        longest_tasks->at(entity) = tasks;
+
+        FunctionHeaps& heaps = entity_heaps[entity];
+        std::vector<Event *> * entity_events = events->at(entity);
+        for (unsigned long index = 0; index < entity_events->size(); index++)
         {
-            if (logging) 
-            {
-                std::cout << "On message " << (*msg)->sendtime << " to " << (*msg)->recvtime;
-                std::cout << " received by " << (*msg)->receiver->getGUID() << std::endl;
-            }
-            // Note we only add if the event is the receive and if the
-            // message is actually in the time frame we're looking for
-            if (logging && ((*msg)->sender == NULL || (*msg)->receiver == NULL))
-            {
-                std::cout << "     Null message." << std::endl;
-            }
-
-            // If we're the receiver, write out the traceback message
-            if ((*msg)->recvtime > start 
-                && (*msg)->sender != NULL && (*msg)->receiver != NULL
-                && (*msg)->receiver == evt)
-            {
-                json jmsg(*msg);
-                jmsg["depth"] = depth;
-                jmsg["sibling"] = false;
-                msg_slice.push_back(jmsg);
-            }
-
-            // If we're the sender and on the main path (!sibling)
-            // AND we're doing a full traceback:
-            //   add forward messages as well
-            else if (!sibling && full_traceback
-                     && (*msg)->sender == evt && (*msg) != last
-                     && (*msg)->sender != NULL && (*msg)->receiver != NULL
-                     && (*msg)->recvtime > start)
-            {
-                json jmsg(*msg);
-                jmsg["depth"] = depth - 1;
-                jmsg["sibling"] = true;
-                msg_slice.push_back(jmsg);
-                CommEvent * rcv = (*msg)->receiver;
-                if ((evt_set.find(rcv->id) == evt_set.end()) && ((rcv->exit - rcv->enter) > min_span))
-                {
-                    json revt(rcv);
-                    revt["depth"] = depth - 1;
-                    revt["sibling"] = true;
-                    evt_slice.push_back(revt);
-                    evt_set.insert(rcv->id);
-
-                    function_names.insert(std::pair<std::string, Function *>(std::to_string(rcv->function), 
-                                                                             functions->at(rcv->function)));
-                }
-            }
-
+            Event * evt = entity_events->at(index);
+            LongestTasks::Task task = { LongestTasks::length(evt, rank_by), entity, index };
+            LongestTasks::keep(heaps[evt->function], task, LongestTasks::summary_size);
+        }
+    });
+    longest_calls->build(occurrences, events, rank_by);
 
-            // If we're not on a sibling line and we're still in the time
-            // window, continue tracing back.
-            if (!sibling && (*msg)->receiver == evt && evt->exit > start && (*msg)->sender) 
+    longest->clear();
+    longest_by_function->clear();
+    for (std::vector<FunctionHeaps>::iterator heaps = entity_heaps.begin();
+         heaps != entity_heaps.end(); ++heaps)
+    {
+        for (FunctionHeaps::iterator heap = heaps->begin(); heap != heaps->end(); ++heap)
+        {
+            std::vector<LongestTasks::Task>& merged = (*longest_by_function)[heap->first];
+            for (std::vector<LongestTasks::Task>::iterator task = heap->second.begin();
+                 task != heap->second.end(); ++task)
             {
-                if (logging) 
-                    std::cout << "     Tracing back to sender " << (*msg)->sender->getGUID() << std::endl;
-                msgTraceBackJSON((*msg)->sender, depth + 1, false, full_traceback, *msg, start, stop,
-                                 entity_start, entities, min_span, 
-                                 msg_slice, evt_slice, evt_set, function_names, logging);
+                LongestTasks::keep(merged, *task, LongestTasks::summary_size);
+                LongestTasks::keep(*longest, *task, LongestTasks::summary_size);
             }
-
         }
     }
+    LongestTasks::finish(*longest);
+    for (FunctionHeaps::iterator heap = longest_by_function->begin();
+         heap != longest_by_function->end(); ++heap)
+    {
+        LongestTasks::finish(heap->second);
+    }
 }
 
-void Trace::eventTraceBackJSON(Event * evt, unsigned long long start,
-    unsigned long long stop, unsigned long long entity_start, unsigned long long entities,
-    unsigned long long min_span, unsigned long long taskid, unsigned long long task_time,
-    bool full_traceback,
-    std::vector<json>& msg_slice, std::vector<json>& evt_slice, std::set<uint64_t>& evt_set,
-    std::map<std::string, Function *>& function_names, bool logging)
+void Trace::buildProfiles()
 {
-    if (logging && evt->getGUID() == taskid)
-    {
-        std::cout << "GUID match at: " << task_time << " in " << evt->enter << " and " << evt->exit << std::endl;
-        std::cout << "      Task ID is " << taskid << " and event GUID is " << evt->getGUID() << std::endl;
-    }
+    function_profiles->assign(events->size(), NULL);
+    RavelUtils::parallelFor(0, events->size(), [this](unsigned long entity) {
+        FunctionProfile * profile = new FunctionProfile();
+        profile->build(events->at(entity), occurrences, entity);
+        function_profiles->at(entity) = profile;
+    });
+}
 
-    // Make sure the event is in range
-    if (!(evt->enter <= task_time && evt->exit >= task_time))
+// Group the segments of each task and the children of each task into
+// contiguous runs. GUID 0 marks events without a task.
+void Trace::indexGUIDs()
+{
+    struct Segment {
+        uint64_t guid;
+        unsigned long long enter;
+        EventLocation location;
+        bool operator<(const Segment& other) const
+        {
+            return guid < other.guid || (guid == other.guid && enter < other.enter);
+        }
+    };
+    std::vector<Segment> segments = std::vector<Segment>();
+    std::vector<std::pair<uint64_t, uint64_t> > families = std::vector<std::pair<uint64_t, uint64_t> >();
+    for (unsigned long entity = 0; entity < events->size(); entity++)
     {
-        return;
+        for (std::vector<Event *>::iterator evt = events->at(entity)->begin();
+             evt != events->at(entity)->end(); ++evt)
+        {
+            if ((*evt)->getGUID() == 0)
+                continue;
+            Segment segment = { (*evt)->getGUID(), (*evt)->enter, { entity, (*evt)->index } };
+            segments.push_back(segment);
+            if ((*evt)->getParentGUID() != 0)
+                families.push_back(std::make_pair((*evt)->getParentGUID(), (*evt)->getGUID()));
+        }
     }
-
-    // Search for focus event
-    if (evt->getGUID() == taskid)
+    std::stable_sort(segments.begin(), segments.end());
+    std::sort(families.begin(), families.end());
+    families.erase(std::unique(families.begin(), families.end()), families.end());
+
+    guid_slots->clear();
+    guid_offsets->clear();
+    guid_events->clear();
+    guid_events->reserve(segments.size());
+    for (std::vector<Segment>::iterator segment = segments.begin();
+         segment != segments.end(); ++segment)
     {
-        if (logging)
-            std::cout << ">>>Event Found!<<<" << std::endl;
-        if (evt->isCommEvent()) 
+        if (segment == segments.begin() || segment->guid != (segment - 1)->guid)
         {
-            if (logging)
-                std::cout << "   is Comm, starting traceback" << std::endl;
-
-            // Traceback from that event
-            msgTraceBackJSON(static_cast<CommEvent *>(evt), 0, false, full_traceback, NULL, start, stop,
-                             entity_start, entities, min_span, msg_slice, evt_slice, evt_set,
-                             function_names, logging);
-        } 
+            guid_slots->insert(std::make_pair(segment->guid, guid_offsets->size()));
+            guid_offsets->push_back(guid_events->size());
+        }
+        guid_events->push_back(segment->location);
     }
-    else
+    guid_offsets->push_back(guid_events->size());
+
+    parent_slots->clear();
+    child_offsets->clear();
+    child_guids->clear();
+    child_guids->reserve(families.size());
+    for (std::vector<std::pair<uint64_t, uint64_t> >::iterator family = families.begin();
+         family != families.end(); ++family)
     {
-        // Search children
-        for (std::vector<Event *>::iterator child = evt->callees->begin();
-            child != evt->callees->end(); ++child)
+        if (family == families.begin() || family->first != (family - 1)->first)
         {
-            if ((*child)->enter > stop)
-            {
-                if (logging)
-                    std::cout << "Child enters after stop, ignore." << std::endl; 
-                continue;
-            }
-            eventTraceBackJSON(*child, start, stop, entity_start,
-                               entities, min_span, taskid, task_time, full_traceback,
-                               msg_slice, evt_slice, evt_set, function_names, logging); 
+            parent_slots->insert(std::make_pair(family->first, child_offsets->size()));
+            child_offsets->push_back(child_guids->size());
         }
+        child_guids->push_back(family->second);
     }
+    child_offsets->push_back(child_guids->size());
 }
 
-void Trace::timeEventToJSON(Event * evt, int depth, unsigned long long start,
-    unsigned long long stop, unsigned long long entity_start, unsigned long long entities,
-    unsigned long long min_span, unsigned long long taskid, 
-    std::vector<json>& slice,
-    std::set<uint64_t>& slice_set, 
-    std::vector<json>& msg_slice,
-    std::vector<json>& collective_slice,
-    std::vector<std::vector<json> >& parent_slice,
-    std::map<std::string, Function *>& function_names)
+// Longest chain of busy time through the trace. An event depends on the
+// event before it in its entity's call tree pre-order, on the senders of
+// the messages it receives and on the previous segment of its GUID, and
+// weighs its self time. Entities are laid out in parallel, then events
+// are visited in topological order: an entity's next event in pre-order
+// is ready once every sender and segment it depends on has been visited,
+// and each visited event offers its path to the events depending on it.
+// Should the dependencies form a cycle, the waiting entity whose next
+// event enters first goes ahead without the ones not yet visited.
+void Trace::findCriticalPath()
 {
-    // Make sure the event is in range
-    if (!(evt->enter < stop && evt->exit > start))
-    {
+    critical_path->clear();
+    critical_reach->clear();
+    critical_floor->clear();
+    unsigned long total = event_offsets->back();
+    if (total == 0)
         return;
-    }
 
-    // Add the event
-    if ((evt->exit - evt->enter) > min_span)
-    {
-        function_names.insert(std::pair<std::string, Function *>(std::to_string(evt->function), 
-                                                                 functions->at(evt->function)));
-        if (evt->isCommEvent()) 
-        {
-            CommEvent * cevt = static_cast<CommEvent *>(evt);
-            json jevt(cevt);
-            //if (cevt->hasMetric(metric)) 
-            //{
-            //    jevt["metrics"] = { cevt->getMetric(metric), cevt->getMetric(metric, true) };
-           // }
-           // if (cevt->isP2P())
-           // {
-           //     P2PEvent * pevt = static_cast<P2PEvent *>(cevt);
-           //     if (pevt->subevents != NULL)
-           //     {
-           //         jevt["coalesced"] = 1;
-           //     }
-           // }
-            if (slice_set.find(evt->id) == slice_set.end())
-                slice.push_back(jevt);
-            if (taskid == 0) 
-            {
-                std::vector<Message *> * messages = cevt->getMessages();
-                if (messages != NULL) {
-                    for (std::vector<Message *>::iterator msg = messages->begin();
-                        msg != messages->end(); ++msg)
-                    {
-                        if (((*msg)->recvtime > stop || !(evt == (*msg)->sender)) 
-                            && (*msg)->sender != NULL && (*msg)->receiver != NULL)
-                        //if ((*msg)->sendtime < start || !(evt == (*msg)->receiver)) 
-                        {
-                            //std::cout << "Attempting to write a message" << std::endl;
-                            json jmsg(*msg);
-                            jmsg["depth"] = 0;
-                            jmsg["sibling"] = false;
-                            msg_slice.push_back(jmsg);
-                        }
-                    }
-                }
-            }
-        } 
-        else 
+    // Pre-order of each entity's call trees
+    std::vector<std::vector<Event *> > order(events->size());
+    RavelUtils::parallelFor(0, events->size(), [this, &order](unsigned long entity) {
+        std::vector<Event *> stack = std::vector<Event *>();
+        std::vector<Event *> * entity_roots = roots->at(entity);
+        order[entity].reserve(events->at(entity)->size());
+        for (std::vector<Event *>::iterator root = entity_roots->begin();
+             root != entity_roots->end(); ++root)
         {
-            // Make sure we have a vector at this depth
-            if (depth >= parent_slice.size())
+            stack.push_back(*root);
+            while (!stack.empty())
             {
-                parent_slice.push_back(std::vector<json>());
-            }
+                Event * evt = stack.back();
+                stack.pop_back();
+                order[entity].push_back(evt);
 
-            json jevt(evt);
-            parent_slice.at(depth).push_back(jevt);
+                for (Event::CalleeList::reverse_iterator child = evt->callees->rbegin();
+                     child != evt->callees->rend(); ++child)
+                {
+                    stack.push_back(*child);
+                }
+            }
         }
+    });
 
-        // Add children
-        for (std::vector<Event *>::iterator child = evt->callees->begin();
-            child != evt->callees->end(); ++child)
+    // Dependencies on other entities' events still to visit, and the
+    // guid_events position of the segment after each one
+    std::vector<unsigned int> pending(total, 0);
+    std::vector<unsigned long> guid_next(total, total);
+    for (std::vector<Message>::iterator msg = messages->begin(); msg != messages->end(); ++msg)
+    {
+        if (msg->hasSender() && msg->hasReceiver()
+            && !(msg->sender_entity == msg->receiver_entity && msg->sender_index == msg->receiver_index))
         {
-            if ((*child)->enter > stop)
-                break;
-            timeEventToJSON(*child, depth + 1, start, stop, entity_start,
-                            entities, min_span, taskid, slice, slice_set, msg_slice, 
-                            collective_slice, parent_slice, 
-                            function_names);
+            pending[event_offsets->at(msg->receiver_entity) + msg->receiver_index]++;
         }
     }
-
-}
-
-
-// Instead of how many functions, calculate how much utilization
-json Trace::utilOverview(unsigned long width, bool get_function, unsigned long function, bool logging)
-{
-    float a_pixel = (last_finalize - last_init) / width;
-    std::vector<float> pixels = std::vector<float>();
-    std::vector<float> fxn_pixels = std::vector<float>();
-    for (unsigned long i = 0; i <= width; i++)
+    for (unsigned long slot = 0; slot + 1 < guid_offsets->size(); slot++)
     {
-        pixels.push_back(0.0);
-        fxn_pixels.push_back(0.0);
+        for (unsigned long g = guid_offsets->at(slot) + 1; g < guid_offsets->at(slot + 1); g++)
+        {
+            const EventLocation& from = guid_events->at(g - 1);
+            const EventLocation& to = guid_events->at(g);
+            guid_next[event_offsets->at(from.entity) + from.index] = g;
+            pending[event_offsets->at(to.entity) + to.index]++;
+        }
     }
-    for (unsigned long long entity = 0; entity < events->size(); entity++)
+
+    std::vector<unsigned long long> length(total, 0);
+    std::vector<unsigned long> previous(total, total);
+    std::vector<bool> swept(total, false);
+    std::vector<unsigned long> next(events->size(), 0);
+    std::vector<unsigned long> ready = std::vector<unsigned long>(); // Entities whose next event is ready
+    for (unsigned long entity = 0; entity < order.size(); entity++)
     {
-        for (std::vector<Event *>::iterator evt = events->at(entity)->begin();
-             evt != events->at(entity)->end(); ++evt)
+        if (!order[entity].empty()
+            && pending[event_offsets->at(entity) + order[entity].front()->index] == 0)
         {
-            // initialize for outside the init range
-            unsigned long pixel_start = 0;
-            unsigned long pixel_end = width;
+            ready.push_back(entity);
+        }
+    }
 
-            // Find the first pixel
-            if ((*evt)->enter > last_init)
-            {
-                pixel_start = ((*evt)->enter - last_init) / a_pixel;
-            } 
-            // Find the last pixel;
-            if ((*evt)->exit < last_finalize)
+    unsigned long end = total;
+    unsigned long long longest = 0;
+    std::vector<EventLocation> dependents = std::vector<EventLocation>();
+    while (true)
+    {
+        if (ready.empty())
+        {
+            unsigned long first = order.size();
+            for (unsigned long entity = 0; entity < order.size(); entity++)
             {
-                pixel_end = ((*evt)->exit - last_init) / a_pixel;
-            }
-
-            if (pixel_start == pixel_end) {
-                // Add the portion of a pixel
-                pixels[pixel_start] += ((*evt)->exit - (*evt)->enter); 
-                if (get_function && (*evt)->function == function)
+                if (next[entity] < order[entity].size()
+                    && (first == order.size()
+                        || order[entity][next[entity]]->enter < order[first][next[first]]->enter))
                 {
-                    fxn_pixels[pixel_start] += ((*evt)->exit - (*evt)->enter); 
+                    first = entity;
                 }
-            } else {
-                // Add the portion of utilization the second pixel
-                pixels[pixel_start] += (pixel_start + 1) * a_pixel - (*evt)->enter + last_init;
-                
-                // Add the amount of utilization over the last pixel
-                pixels[pixel_end] += (*evt)->exit - last_init - pixel_end * a_pixel;
-
-                if (get_function && (*evt)->function == function)
-                {
-                    // Add the portion of utilization the second pixel
-                    fxn_pixels[pixel_start] += (pixel_start + 1) * a_pixel - (*evt)->enter + last_init;
-                    
-                    // Add the amount of utilization over the last pixel
-                    fxn_pixels[pixel_end] += (*evt)->exit - last_init - pixel_end * a_pixel;
-                }
-
             }
+            if (first == order.size())
+                break;
+            ready.push_back(first);
+        }
+
+        unsigned long entity = ready.back();
+        ready.pop_back();
+        Event * evt = order[entity][next[entity]];
+        unsigned long position = event_offsets->at(entity) + evt->index;
 
+        length[position] = self_times->at(position);
+        if (previous[position] != total)
+            length[position] += length[previous[position]];
+        swept[position] = true;
+        if (end == total || length[position] > longest)
+        {
+            longest = length[position];
+            end = position;
+        }
 
-            for (unsigned long i = pixel_start + 1; i < pixel_end; i++)
+        // Offer the path to the receivers of its messages, its next GUID
+        // segment and the next event of its entity
+        dependents.clear();
+        std::vector<unsigned long> * offsets = message_offsets->at(entity);
+        std::vector<unsigned long> * list = message_lists->at(entity);
+        for (unsigned long m = offsets->at(evt->index); m < offsets->at(evt->index + 1); m++)
+        {
+            Message * msg = &(messages->at(list->at(m)));
+            if (msg->sentBy(evt) && msg->hasReceiver() && !msg->receivedBy(evt))
             {
-                pixels[i] += a_pixel;
+                EventLocation receiver = { msg->receiver_entity, msg->receiver_index };
+                dependents.push_back(receiver);
             }
-
-            if (get_function && (*evt)->function == function)
+        }
+        if (guid_next[position] != total)
+            dependents.push_back(guid_events->at(guid_next[position]));
+        for (std::vector<EventLocation>::iterator dependent = dependents.begin();
+             dependent != dependents.end(); ++dependent)
+        {
+            unsigned long target = event_offsets->at(dependent->entity) + dependent->index;
+            if (swept[target])
+                continue;
+            if (previous[target] == total || length[position] > length[previous[target]])
+                previous[target] = position;
+            pending[target]--;
+            if (pending[target] == 0 && dependent->entity != entity
+                && next[dependent->entity] < order[dependent->entity].size()
+                && order[dependent->entity][next[dependent->entity]]->index == dependent->index)
             {
-                for (unsigned long i = pixel_start + 1; i < pixel_end; i++)
-                {
-                    fxn_pixels[i] += a_pixel;
-                }
+                ready.push_back(dependent->entity);
             }
         }
+
+        next[entity]++;
+        if (next[entity] < order[entity].size())
+        {
+            unsigned long target = event_offsets->at(entity) + order[entity][next[entity]]->index;
+            if (previous[target] == total || length[position] > length[previous[target]])
+                previous[target] = position;
+            if (pending[target] == 0)
+                ready.push_back(entity);
+        }
     }
 
-    // Normalize by the number of processors/entities
-    unsigned long long all_time_per_pixel = a_pixel * events->size();
+    for (unsigned long position = end; position != total; position = previous[position])
+    {
+        unsigned long entity = std::upper_bound(event_offsets->begin(), event_offsets->end(), position)
+                               - event_offsets->begin() - 1;
+        critical_path->push_back(events->at(entity)->at(position - event_offsets->at(entity)));
+    }
+    std::reverse(critical_path->begin(), critical_path->end());
+    critical_path->shrink_to_fit();
+
+    unsigned long long reach = 0;
+    critical_reach->reserve(critical_path->size());
+    for (std::vector<Event *>::iterator evt = critical_path->begin();
+         evt != critical_path->end(); ++evt)
+    {
+        reach = std::max(reach, (*evt)->exit);
+        critical_reach->push_back(reach);
+    }
+
+    critical_floor->assign(critical_path->size(), 0);
+    unsigned long long floor = ULLONG_MAX;
+    for (unsigned long step = critical_path->size(); step > 0; step--)
+    {
+        floor = std::min(floor, critical_path->at(step - 1)->enter);
+        (*critical_floor)[step - 1] = floor;
+    }
+}
+
+// Sort every sibling list by enter and record the running maximum exit,
+// so window and point queries can binary search to the first sibling
+// still active instead of scanning every task on a timeline
+void Trace::indexCallTrees()
+{
+    event_offsets->clear();
+    event_offsets->push_back(0);
+    for (unsigned long entity = 0; entity < events->size(); entity++)
+    {
+        event_offsets->push_back(event_offsets->back() + events->at(entity)->size());
+        for (std::vector<Event *>::iterator evt = events->at(entity)->begin();
+             evt != events->at(entity)->end(); ++evt)
+        {
+            Event::CalleeList * callees = (*evt)->callees;
+            std::stable_sort(callees->begin(), callees->end(), Event::eventEnterLessThan);
+            setPrefixExit(callees->begin(), callees->end());
+        }
+
+        std::vector<Event *> * entity_roots = roots->at(entity);
+        std::stable_sort(entity_roots->begin(), entity_roots->end(), Event::eventEnterLessThan);
+        setPrefixExit(entity_roots->begin(), entity_roots->end());
+    }
+    traceback_visited->assign(event_offsets->back(), false);
+}
+
+template <typename Iterator>
+void Trace::setPrefixExit(Iterator begin, Iterator end)
+{
+    unsigned long long prefix_exit = 0;
+    for (Iterator sibling = begin; sibling != end; ++sibling)
+    {
+        prefix_exit = std::max(prefix_exit, (*sibling)->exit);
+        (*sibling)->prefix_exit = prefix_exit;
+    }
+}
+
+// Finest level has at most lod_buckets across the trace, the coarsest
+// a single bucket
+void Trace::buildPyramids()
+{
+    unsigned long long span = (max_time > min_time) ? max_time - min_time : 0;
+    lod_shift = 0;
+    while ((span >> lod_shift) >= lod_buckets)
+        lod_shift++;
+    lod_levels = 1;
+    while (lod_shift + lod_levels < 64 && (1ULL << (lod_shift + lod_levels - 1)) <= span)
+        lod_levels++;
+
+    lod->assign(events->size(), NULL);
+    RavelUtils::parallelFor(0, events->size(), [this](unsigned long entity) {
+        LODPyramid * pyramid = new LODPyramid(min_time, lod_shift, lod_levels);
+        pyramid->build(events->at(entity), max_depth);
+        lod->at(entity) = pyramid;
+    });
+
+    unsigned long long row_width = std::max(1ULL, (span + row_bins) / row_bins);
+    row_table = new RowTable(min_time, row_width, span / row_width + 1);
+    row_table->build(events);
+}
+
+// Tables behind utilOverview and timeOverview so that neither has to
+// visit the events again
+void Trace::buildOverviews()
+{
+    unsigned long long span = (last_finalize > last_init) ? last_finalize - last_init : 1;
+    unsigned long long bin_width = std::max(1ULL, (span + overview_bins - 1) / overview_bins);
+    unsigned long bins = (span + bin_width - 1) / bin_width;
+
+    utilization = new BusyProfile(last_init, bin_width, bins);
+    for (unsigned long long entity = 0; entity < events->size(); entity++)
+    {
+        for (std::vector<Event *>::iterator evt = events->at(entity)->begin();
+             evt != events->at(entity)->end(); ++evt)
+        {
+            utilization->add((*evt)->enter, (*evt)->exit);
+
+            if ((*evt)->isCommEvent())
+            {
+                comm_enters->push_back((*evt)->enter);
+                comm_exits->push_back((*evt)->exit);
+            }
+        }
+    }
+
+    utilization->finish();
+    std::sort(comm_enters->begin(), comm_enters->end());
+    std::sort(comm_exits->begin(), comm_exits->end());
+
+    unsigned long long imbalance_width = std::max(1ULL, (span + imbalance_bins - 1) / imbalance_bins);
+    imbalance = new ImbalanceTable(last_init, imbalance_width,
+                                   (span + imbalance_width - 1) / imbalance_width);
+    imbalance->build(roots);
+
+    std::vector<int> function_ids = std::vector<int>();
+    for (std::map<int, Function *>::iterator fxn = functions->begin(); fxn != functions->end(); ++fxn)
+        function_ids.push_back(fxn->first);
+    function_utilization = new FunctionBusyTable(last_init, bin_width, bins);
+    function_utilization->build(occurrences, events, function_ids);
+}
+
+// Totals for every system tree node, from the entities up. Entities are
+// summarized in parallel, then each level of the tree in parallel from
+// the deepest, so a node's children are always done before it.
+void Trace::rollUpSystemTree()
+{
+    if (!system_tree || system_tree->empty())
+        return;
+
+    std::vector<std::vector<SystemNode *> > levels = std::vector<std::vector<SystemNode *> >();
+    for (std::vector<SystemNode *>::iterator node = system_tree->begin();
+         node != system_tree->end(); ++node)
+    {
+        unsigned long depth = 0;
+        for (long parent = (*node)->parent; parent >= 0; parent = system_tree->at(parent)->parent)
+            depth++;
+        if (depth >= levels.size())
+            levels.resize(depth + 1);
+        levels[depth].push_back(*node);
+    }
+
+    RavelUtils::parallelFor(0, system_tree->size(), [this](unsigned long i) {
+        SystemNode * node = system_tree->at(i);
+        if (node->entity >= 0 && node->entity < static_cast<long>(events->size()))
+            summarizeEntity(node);
+    });
+
+    for (unsigned long depth = levels.size(); depth > 0; depth--)
+    {
+        std::vector<SystemNode *>& level = levels[depth - 1];
+        RavelUtils::parallelFor(0, level.size(), [this, &level](unsigned long i) {
+            SystemNode * node = level[i];
+            if (node->children->empty())
+                return;
+
+            std::map<int, unsigned long long> function_time = std::map<int, unsigned long long>();
+            for (std::vector<unsigned long>::iterator child = node->children->begin();
+                 child != node->children->end(); ++child)
+            {
+                SystemNode * c = system_tree->at(*child);
+                node->entities += c->entities;
+                node->busy += c->busy;
+                node->messages += c->messages;
+                node->message_bytes += c->message_bytes;
+                if (!c->function_time)
+                    continue;
+                for (std::vector<std::pair<int, unsigned long long> >::iterator ft = c->function_time->begin();
+                     ft != c->function_time->end(); ++ft)
+                {
+                    function_time[ft->first] += ft->second;
+                }
+            }
+
+            unsigned long long most = 0;
+            node->function_time = new std::vector<std::pair<int, unsigned long long> >(function_time.begin(),
+                                                                                       function_time.end());
+            for (std::map<int, unsigned long long>::iterator ft = function_time.begin();
+                 ft != function_time.end(); ++ft)
+            {
+                if (ft->second > most)
+                {
+                    most = ft->second;
+                    node->function = ft->first;
+                }
+            }
+        });
+    }
+
+    // Only the dominant functions are needed from here on
+    for (std::vector<SystemNode *>::iterator node = system_tree->begin();
+         node != system_tree->end(); ++node)
+    {
+        delete (*node)->function_time;
+        (*node)->function_time = NULL;
+    }
+}
+
+// Busy time covered by the call trees, self time by function and messages
+// sent for the entity at a leaf
+void Trace::summarizeEntity(SystemNode * leaf)
+{
+    leaf->entities = 1;
+
+    unsigned long long covered = 0;
+    std::vector<Event *> * entity_roots = roots->at(leaf->entity);
+    for (std::vector<Event *>::iterator root = entity_roots->begin();
+         root != entity_roots->end(); ++root)
+    {
+        unsigned long long enter = std::max(covered, (*root)->enter);
+        if ((*root)->exit > enter)
+            leaf->busy += (*root)->exit - enter;
+        covered = std::max(covered, (*root)->exit);
+    }
+
+    std::map<int, unsigned long long> function_time = std::map<int, unsigned long long>();
+    std::vector<Event *> * entity_events = events->at(leaf->entity);
+    std::vector<unsigned long> * offsets = message_offsets->at(leaf->entity);
+    std::vector<unsigned long> * list = message_lists->at(leaf->entity);
+    unsigned long offset = event_offsets->at(leaf->entity);
+    for (std::vector<Event *>::iterator evt = entity_events->begin();
+         evt != entity_events->end(); ++evt)
+    {
+        unsigned long long self_time = self_times->at(offset + (*evt)->index);
+        if (self_time > 0)
+            function_time[(*evt)->function] += self_time;
+
+        for (unsigned long m = offsets->at((*evt)->index); m < offsets->at((*evt)->index + 1); m++)
+        {
+            Message * msg = &(messages->at(list->at(m)));
+            if (msg->sentBy(*evt))
+            {
+                leaf->messages++;
+                leaf->message_bytes += msg->size;
+            }
+        }
+    }
+
+    unsigned long long most = 0;
+    leaf->function_time = new std::vector<std::pair<int, unsigned long long> >(function_time.begin(),
+                                                                               function_time.end());
+    for (std::map<int, unsigned long long>::iterator ft = function_time.begin();
+         ft != function_time.end(); ++ft)
+    {
+        if (ft->second > most)
+        {
+            most = ft->second;
+            leaf->function = ft->first;
+        }
+    }
+}
+
+CommEvent * Trace::messageSender(const Message * msg)
+{
+    return static_cast<CommEvent *>(events->at(msg->sender_entity)->at(msg->sender_index));
+}
+
+CommEvent * Trace::messageReceiver(const Message * msg)
+{
+    return static_cast<CommEvent *>(events->at(msg->receiver_entity)->at(msg->receiver_index));
+}
+
+// Find the smallest event in a timeline that contains the given time
+Event * Trace::findEvent(int entity, unsigned long long time)
+{
+    if (entity < 0 || entity >= roots->size())
+        return NULL;
+
+    Event * found = NULL;
+    std::vector<Event *> * entity_roots = roots->at(entity);
+    for (std::vector<Event *>::iterator root
+            = Event::firstActiveAt(entity_roots->begin(), entity_roots->end(), time);
+         root != entity_roots->end() && (*root)->enter <= time; ++root)
+    {
+        found = (*root)->findChild(time);
+        if (found)
+            return found;
+    }
+
+    return found;
+}
+
+json Trace::timeToJSON(unsigned long long start, unsigned long long stop, 
+                       unsigned long long entity_start,
+                       unsigned long long entities,
+                       unsigned long width, 
+                       unsigned long rows,
+                       unsigned long long taskid,
+                       unsigned long long task_time,
+                       unsigned long traceback_state,
+                       unsigned long long hover,
+                       bool logging)
+{
+    json jo;
+
+    jo["path"] = fullpath;
+    jo["mintime"] = last_init;
+    jo["maxtime"] = last_finalize + 10; // So the finalize has some length
+    jo["starttime"] = start;
+    jo["stoptime"] = stop;
+    jo["units"] = units;
+    jo["max_depth"] = max_depth;
+    jo["entities"] = entities;
+    jo["entity_start"] = entity_start;
+    if (start > stop || start > max_time || stop < min_time)
+    {
+        jo["error"] = "Incorrect time range.";
+        return jo;
+    }
+
+    // Determine min_span of half a pixel in width
+    unsigned long long a_pixel = (stop - start) / width / 2;
+
+    // When zoomed out past the finest pyramid level, events no longer than
+    // a bucket of the matching level are sent as density instead
+    int lod_level = LODPyramid::levelFor(a_pixel, lod_shift, lod_levels);
+    unsigned long long min_span = a_pixel;
+    if (lod_level >= 0)
+        min_span = 1ULL << (lod_shift + lod_level);
+
+    std::set<uint64_t> event_set = std::set<uint64_t>();
+    std::vector<json> event_slice = std::vector<json>();
+    std::vector<json> msg_slice = std::vector<json>();
+    std::vector<json> collective_slice = std::vector<json>();
+    std::vector<std::vector<json> >  parent_slice
+        = std::vector<std::vector<json> >();
+    parent_slice.push_back(std::vector<json>());
+    std::vector<json> density_slice = std::vector<json>();
+    std::set<int> function_ids = std::set<int>();
+
+    unsigned long long entity_stop = entity_start + entities;
+
+    // More entities than rows to draw them in, so summarize groups of
+    // adjacent entities instead of sending their events and messages.
+    // Trace back, the critical path and hovering still apply.
+    bool row_mode = rows > 0 && entities > rows;
+    if (row_mode)
+        rowsJSON(start, stop, entity_start, entities, width, rows, function_ids, jo);
+
+    // Trace back events
+    if (taskid != 0)
+    {
+        bool full_traceback = false;
+        if (traceback_state == traceback_full) {
+            full_traceback = true;
+        }
+        traceBackJSON(start, entity_start, entity_stop, a_pixel, taskid, task_time,
+                      full_traceback, msg_slice, event_slice, event_set,
+                      function_ids, logging);
+    }
+
+    // All events, unless summarized by rows
+    if (!row_mode)
+    {
+        for (unsigned long long entity = entity_start; entity < entity_stop; entity++)
+        {
+            if (lod_level >= 0)
+                densityJSON(entity, start, stop, lod_level, density_slice, function_ids);
+
+            std::vector<Event *> * entity_roots = roots->at(entity);
+            for (std::vector<Event *>::iterator root
+                    = Event::firstActiveAt(entity_roots->begin(), entity_roots->end(), start);
+                 root != entity_roots->end() && (*root)->enter < stop; ++root)
+            {
+                timeEventToJSON(*root, 0, start, stop, entity_start, entities,
+                                min_span, event_slice, event_set,
+                                collective_slice,
+                                parent_slice, function_ids);
+            }
+        }
+    }
+
+    // Messages overlapping the window, whether or not their events are
+    // drawn. Trace back sends only the messages it follows.
+    if (taskid == 0 && !row_mode)
+        messagesJSON(start, stop, entity_start, entity_stop, msg_slice);
+
+    std::vector<json> critical_slice = std::vector<json>();
+    criticalPathJSON(start, stop, entity_start, entity_stop, a_pixel,
+                     critical_slice, function_ids);
+
+    // Should autoconvert from std::vector and std::map to json
+    jo["events"] = event_slice;
+    jo["parent_events"] = parent_slice;
+    jo["messages"] = msg_slice;
+    jo["collectives"] = collective_slice;
+    jo["density"] = density_slice;
+    jo["critical_path"] = critical_slice;
+    jo["functions"] = functionsJSON(function_ids);
+
+    std::vector<std::string> hover_strings = std::vector<std::string>();
+    std::unordered_map<uint64_t, unsigned long>::iterator hover_slot = guid_slots->find(hover);
+    if (hover && hover_slot != guid_slots->end())
+    {
+        for (unsigned long s = guid_offsets->at(hover_slot->second);
+             s < guid_offsets->at(hover_slot->second + 1); s++)
+        {
+            EventLocation& location = guid_events->at(s);
+            hover_strings.push_back(std::to_string(events->at(location.entity)->at(location.index)->id));
+        }
+    }
+    jo["hover_ids"] = hover_strings;
+
+    return jo;
+}
+
+// Trace back from every segment of the focus task running at task_time
+// on the window's entities, found through the GUID index. The bitmap
+// keeps any event from being expanded twice, even across segments.
+void Trace::traceBackJSON(unsigned long long start,
+    unsigned long long entity_start, unsigned long long entity_stop,
+    unsigned long long min_span, unsigned long long taskid, unsigned long long task_time,
+    bool full_traceback,
+    std::vector<json>& msg_slice, std::vector<json>& evt_slice, std::set<uint64_t>& evt_set,
+    std::set<int>& function_ids, bool logging)
+{
+    std::unordered_map<uint64_t, unsigned long>::iterator slot = guid_slots->find(taskid);
+    if (slot == guid_slots->end())
+    {
+        if (logging)
+            std::cout << "No events for task " << taskid << std::endl;
+        return;
+    }
+
+    std::vector<unsigned long> expanded = std::vector<unsigned long>();
+    for (unsigned long s = guid_offsets->at(slot->second); s < guid_offsets->at(slot->second + 1); s++)
+    {
+        EventLocation& location = guid_events->at(s);
+        Event * evt = events->at(location.entity)->at(location.index);
+        if (location.entity < entity_start || location.entity >= entity_stop
+            || !(evt->enter <= task_time && evt->exit >= task_time))
+        {
+            continue;
+        }
+
+        if (logging)
+            std::cout << ">>>Event Found!<<< " << evt->enter << " to " << evt->exit << std::endl;
+        if (evt->isCommEvent())
+        {
+            msgTraceBackJSON(static_cast<CommEvent *>(evt), full_traceback, start, min_span,
+                             msg_slice, evt_slice, evt_set, function_ids, expanded, logging);
+        }
+    }
+
+    for (std::vector<unsigned long>::iterator position = expanded.begin();
+         position != expanded.end(); ++position)
+    {
+        (*traceback_visited)[*position] = false;
+    }
+}
+
+// Follow received messages back to their senders, depth first with an
+// explicit stack so long dependency chains cannot overflow the call
+// stack. Each event is expanded at most once; its position is added to
+// expanded so the caller can clear the bitmap.
+void Trace::msgTraceBackJSON(CommEvent * focus, bool full_traceback,
+    unsigned long long start, unsigned long long min_span,
+    std::vector<json>& msg_slice, std::vector<json>& evt_slice,
+    std::set<uint64_t>& evt_set, std::set<int>& function_ids,
+    std::vector<unsigned long>& expanded, bool logging)
+{
+    struct Frame {
+        CommEvent * evt;
+        int depth;
+        Message * last; // Message followed to reach this event
+        unsigned long next; // Position in the entity's message list
+    };
+
+    unsigned long position = event_offsets->at(focus->entity) + focus->index;
+    if ((*traceback_visited)[position])
+        return;
+    (*traceback_visited)[position] = true;
+    expanded.push_back(position);
+
+    std::vector<Frame> stack = std::vector<Frame>();
+    Frame root = { focus, 0, NULL, message_offsets->at(focus->entity)->at(focus->index) };
+    stack.push_back(root);
+    if ((evt_set.find(focus->id) == evt_set.end()) && ((focus->exit - focus->enter) > min_span))
+    {
+        json jevt = eventJSON(focus);
+        jevt["depth"] = 0;
+        jevt["sibling"] = false;
+        evt_slice.push_back(jevt);
+        evt_set.insert(focus->id);
+
+        function_ids.insert(focus->function);
+    }
+
+    while (!stack.empty())
+    {
+        Frame& frame = stack.back();
+        CommEvent * evt = frame.evt;
+        int depth = frame.depth;
+        if (frame.next == message_offsets->at(evt->entity)->at(evt->index + 1))
+        {
+            stack.pop_back();
+            continue;
+        }
+        Message * msg = &(messages->at(message_lists->at(evt->entity)->at(frame.next)));
+        Message * last = frame.last;
+        frame.next++;
+
+        if (logging && msg->hasReceiver())
+        {
+            std::cout << "On message " << msg->sendtime << " to " << msg->recvtime;
+            std::cout << " received by " << messageReceiver(msg)->getGUID() << std::endl;
+        }
+        if (logging && (!msg->hasSender() || !msg->hasReceiver()))
+        {
+            std::cout << "     Null message." << std::endl;
+        }
+
+        // If we're the receiver, write out the traceback message
+        if (msg->recvtime > start 
+            && msg->hasSender() && msg->hasReceiver()
+            && msg->receivedBy(evt))
+        {
+            json jmsg(msg);
+            jmsg["depth"] = depth;
+            jmsg["sibling"] = false;
+            msg_slice.push_back(jmsg);
+        }
+
+        // If we're the sender AND we're doing a full traceback:
+        //   add forward messages as well
+        else if (full_traceback
+                 && msg->sentBy(evt) && msg != last
+                 && msg->hasSender() && msg->hasReceiver()
+                 && msg->recvtime > start)
+        {
+            json jmsg(msg);
+            jmsg["depth"] = depth - 1;
+            jmsg["sibling"] = true;
+            msg_slice.push_back(jmsg);
+            CommEvent * rcv = messageReceiver(msg);
+            if ((evt_set.find(rcv->id) == evt_set.end()) && ((rcv->exit - rcv->enter) > min_span))
+            {
+                json revt = eventJSON(rcv);
+                revt["depth"] = depth - 1;
+                revt["sibling"] = true;
+                evt_slice.push_back(revt);
+                evt_set.insert(rcv->id);
+
+                function_ids.insert(rcv->function);
+            }
+        }
+
+        // If we're still in the time window, continue tracing back
+        // unless the sender has already been expanded
+        if (msg->receivedBy(evt) && evt->exit > start && msg->hasSender()) 
+        {
+            CommEvent * sender = messageSender(msg);
+            position = event_offsets->at(sender->entity) + sender->index;
+            if ((*traceback_visited)[position])
+                continue;
+            (*traceback_visited)[position] = true;
+            expanded.push_back(position);
+
+            if (logging) 
+                std::cout << "     Tracing back to sender " << sender->getGUID() << std::endl;
+            if ((evt_set.find(sender->id) == evt_set.end()) && ((sender->exit - sender->enter) > min_span))
+            {
+                json jevt = eventJSON(sender);
+                jevt["depth"] = depth + 1;
+                jevt["sibling"] = false;
+                evt_slice.push_back(jevt);
+                evt_set.insert(sender->id);
+
+                function_ids.insert(sender->function);
+            }
+            Frame next = { sender, depth + 1, msg,
+                           message_offsets->at(sender->entity)->at(sender->index) };
+            stack.push_back(next);
+        }
+    }
+}
+
+// Write out one visible event and, for comm events, its messages
+void Trace::addEventJSON(Event * evt, int depth,
+    std::vector<json>& slice,
+    std::set<uint64_t>& slice_set,
+    std::vector<std::vector<json> >& parent_slice,
+    std::set<int>& function_ids)
+{
+    function_ids.insert(evt->function);
+    if (evt->isCommEvent()) 
+    {
+        json jevt = eventJSON(evt);
+        //if (cevt->hasMetric(metric)) 
+        //{
+        //    jevt["metrics"] = { cevt->getMetric(metric), cevt->getMetric(metric, true) };
+       // }
+       // if (cevt->isP2P())
+       // {
+       //     P2PEvent * pevt = static_cast<P2PEvent *>(cevt);
+       //     if (pevt->subevents != NULL)
+       //     {
+       //         jevt["coalesced"] = 1;
+       //     }
+       // }
+        if (slice_set.find(evt->id) == slice_set.end())
+            slice.push_back(jevt);
+    } 
+    else 
+    {
+        // Make sure we have a vector at this depth
+        while (depth >= parent_slice.size())
+        {
+            parent_slice.push_back(std::vector<json>());
+        }
+
+        parent_slice.at(depth).push_back(eventJSON(evt));
+    }
+}
+
+// Matched messages in flight during the window with either end on one
+// of the window's entities, in send order. Only the window's entities'
+// runs are looked at, and a message between two of them is taken from
+// its sender's run.
+void Trace::messagesJSON(unsigned long long start, unsigned long long stop,
+    unsigned long long entity_start, unsigned long long entity_stop,
+    std::vector<json>& msg_slice)
+{
+    std::vector<unsigned long> found = std::vector<unsigned long>();
+    unsigned long long last_entity = std::min(entity_stop, static_cast<unsigned long long>(events->size()));
+    for (unsigned long long entity = entity_start; entity < last_entity; entity++)
+    {
+        unsigned long run_end = message_entity_offsets->at(entity + 1);
+        unsigned long position = std::lower_bound(message_reach->begin() + message_entity_offsets->at(entity),
+                                                  message_reach->begin() + run_end, start)
+                                 - message_reach->begin();
+        for ( ; position < run_end; position++)
+        {
+            Message& msg = messages->at(message_entity_list->at(position));
+            if (msg.sendtime > stop)
+                break;
+            if (msg.recvtime < start)
+                continue;
+            if (msg.sender_entity != entity
+                && msg.sender_entity >= entity_start && msg.sender_entity < entity_stop)
+            {
+                continue;
+            }
+            found.push_back(message_entity_list->at(position));
+        }
+    }
+    std::sort(found.begin(), found.end());
+
+    for (std::vector<unsigned long>::iterator m = found.begin(); m != found.end(); ++m)
+    {
+        json jmsg(&(messages->at(*m)));
+        jmsg["depth"] = 0;
+        jmsg["sibling"] = false;
+        msg_slice.push_back(jmsg);
+    }
+}
+
+// Steps of the critical path overlapping the window on the window's
+// entities. Consecutive steps on one entity closer than min_span are
+// sent as one segment.
+void Trace::criticalPathJSON(unsigned long long start, unsigned long long stop,
+    unsigned long long entity_start, unsigned long long entity_stop,
+    unsigned long long min_span,
+    std::vector<json>& critical_slice,
+    std::set<int>& function_ids)
+{
+    unsigned long first = std::lower_bound(critical_reach->begin(), critical_reach->end(), start)
+                          - critical_reach->begin();
+    Event * last = NULL;
+    unsigned long long segment_exit = 0, segment_count = 0;
+    for (unsigned long step = first;
+         step < critical_path->size() && critical_floor->at(step) < stop; step++)
+    {
+        Event * evt = critical_path->at(step);
+        if (evt->exit <= start || evt->enter >= stop
+            || evt->entity < entity_start || evt->entity >= entity_stop)
+            continue;
+
+        if (last && last->entity == evt->entity && evt->enter >= last->enter
+            && evt->enter <= segment_exit + min_span)
+        {
+            segment_exit = std::max(segment_exit, evt->exit);
+            segment_count++;
+            critical_slice.back()["exit"] = segment_exit;
+            critical_slice.back()["count"] = segment_count;
+            last = evt;
+            continue;
+        }
+
+        function_ids.insert(evt->function);
+        critical_slice.push_back({
+            {"step", step},
+            {"entity", evt->entity},
+            {"enter", evt->enter},
+            {"exit", evt->exit},
+            {"function", evt->function},
+            {"count", 1}
+        });
+        last = evt;
+        segment_exit = evt->exit;
+        segment_count = 1;
+    }
+}
+
+// An event as the viewer shows it, with its self time, any wait and, if
+// it stands in for coalesced calls, the run. Every event sent for a
+// window or a traceback goes through here.
+json Trace::eventJSON(Event * evt)
+{
+    json jevt(evt);
+    jevt["self_time"] = selfTime(evt);
+    unsigned long position = event_offsets->at(evt->entity) + evt->index;
+    if (wait_times->at(position) > 0)
+    {
+        jevt["wait"] = wait_times->at(position);
+        jevt["wait_kind"] = wait_kinds->at(position);
+    }
+    addAggregateJSON(evt, jevt);
+    return jevt;
+}
+
+// Events standing in for a run of coalesced calls describe the run
+void Trace::addAggregateJSON(Event * evt, json& jevt)
+{
+    if (!evt->metrics->hasMetric("Coalesced Total"))
+        return;
+
+    jevt["aggregate"] = {
+        {"count", static_cast<unsigned long long>(evt->metrics->getMetric("Function Count"))},
+        {"total", static_cast<unsigned long long>(evt->metrics->getMetric("Coalesced Total"))},
+        {"min", static_cast<unsigned long long>(evt->metrics->getMetric("Coalesced Min"))},
+        {"max", static_cast<unsigned long long>(evt->metrics->getMetric("Coalesced Max"))}
+    };
+}
+
+// Functions seen by a query, keyed by stringified ID for the frontend
+json Trace::functionsJSON(std::set<int>& function_ids)
+{
+    json jfunctions = json::object();
+    for (std::set<int>::iterator fxn = function_ids.begin();
+         fxn != function_ids.end(); ++fxn)
+    {
+        jfunctions[std::to_string(*fxn)] = functions->at(*fxn);
+    }
+    return jfunctions;
+}
+
+// Row groups of adjacent entities with, per column of whole row table
+// bins about a pixel wide, the fraction of the group's time that is busy,
+// how many events enter and the function with the most self time in the
+// busiest bin of its busiest entity
+void Trace::rowsJSON(unsigned long long start, unsigned long long stop,
+    unsigned long long entity_start, unsigned long long entities,
+    unsigned long width, unsigned long rows,
+    std::set<int>& function_ids,
+    json& jo)
+{
+    unsigned long long group = (entities + rows - 1) / rows;
+    unsigned long long entity_stop = std::min(entity_start + entities,
+                                              static_cast<unsigned long long>(events->size()));
+
+    // Columns start at multiples of their width so they stay put as the
+    // window pans
+    unsigned long column = std::max(1ULL, (stop - start) / width / row_table->bin_width);
+    unsigned long first = (start > row_table->start) ? (start - row_table->start) / row_table->bin_width : 0;
+    first -= first % column;
+
+    std::vector<json> row_slice = std::vector<json>();
+    std::vector<json> bucket_slice = std::vector<json>();
+    for (unsigned long long row_start = entity_start; row_start < entity_stop; row_start += group)
+    {
+        unsigned long long row_stop = std::min(row_start + group, entity_stop);
+        unsigned long long row = row_slice.size();
+        row_slice.push_back({
+            {"row", row},
+            {"entity_start", row_start},
+            {"entities", row_stop - row_start}
+        });
+
+        for (unsigned long bin = first;
+             bin < row_table->bins && row_table->start + bin * row_table->bin_width < stop;
+             bin += column)
+        {
+            unsigned long last = std::min(bin + column, row_table->bins);
+            unsigned long long busy = 0, count = 0, busiest = 0;
+            unsigned long long busiest_entity = row_start;
+            for (unsigned long long entity = row_start; entity < row_stop; entity++)
+            {
+                unsigned long long entity_busy = row_table->busy(entity, bin, last);
+                busy += entity_busy;
+                count += row_table->count(entity, bin, last);
+                if (entity_busy > busiest)
+                {
+                    busiest = entity_busy;
+                    busiest_entity = entity;
+                }
+            }
+            if (busy == 0 && count == 0)
+                continue;
+
+            int function = -1;
+            unsigned long long function_busy = 0;
+            for (unsigned long b = bin; b < last; b++)
+            {
+                unsigned long long bin_busy = row_table->busy(busiest_entity, b, b + 1);
+                if (function < 0 || bin_busy > function_busy)
+                {
+                    function = row_table->function(busiest_entity, b);
+                    function_busy = bin_busy;
+                }
+            }
+            if (function >= 0)
+                function_ids.insert(function);
+
+            unsigned long long enter = row_table->start + bin * row_table->bin_width;
+            bucket_slice.push_back({
+                {"row", row},
+                {"enter", enter},
+                {"exit", row_table->start + last * row_table->bin_width},
+                {"busy", std::min(1.0, busy / static_cast<double>(RowTable::scale * (last - bin)
+                                                                  * (row_stop - row_start)))},
+                {"count", count},
+                {"function", function}
+            });
+        }
+    }
+
+    jo["rows"] = row_slice;
+    jo["row_density"] = bucket_slice;
+}
+
+// Pyramid buckets of one entity overlapping the window, one entry per
+// non-empty bucket and depth
+void Trace::densityJSON(unsigned long long entity,
+    unsigned long long start, unsigned long long stop,
+    int level,
+    std::vector<json>& density_slice,
+    std::set<int>& function_ids)
+{
+    LODPyramid * pyramid = lod->at(entity);
+    unsigned long long width = pyramid->bucketWidth(level);
+    unsigned long long first = (start > pyramid->origin) ? (start - pyramid->origin) / width : 0;
+    for (int depth = 0; depth < pyramid->depths(); depth++)
+    {
+        const std::vector<LODPyramid::Bucket>& buckets = pyramid->buckets(level, depth);
+        for (unsigned long b = LODPyramid::lowerBound(buckets, first); b < buckets.size(); b++)
+        {
+            unsigned long long enter = pyramid->origin + buckets[b].index * width;
+            if (enter >= stop)
+                break;
+
+            function_ids.insert(buckets[b].function);
+            density_slice.push_back({
+                {"entity", entity},
+                {"depth", depth},
+                {"enter", enter},
+                {"exit", enter + width},
+                {"busy", buckets[b].busy},
+                {"count", buckets[b].count},
+                {"function", buckets[b].function}
+            });
+        }
+    }
+}
+
+void Trace::timeEventToJSON(Event * evt, int depth, unsigned long long start,
+    unsigned long long stop, unsigned long long entity_start, unsigned long long entities,
+    unsigned long long min_span,
+    std::vector<json>& slice,
+    std::set<uint64_t>& slice_set, 
+    std::vector<json>& collective_slice,
+    std::vector<std::vector<json> >& parent_slice,
+    std::set<int>& function_ids)
+{
+    // Make sure the event is in range
+    if (!(evt->enter < stop && evt->exit > start))
+    {
+        return;
+    }
+
+    // Add the event
+    if ((evt->exit - evt->enter) > min_span)
+    {
+        addEventJSON(evt, depth, slice, slice_set, parent_slice, function_ids);
+
+        // Add children
+        for (Event::CalleeList::iterator child
+                = Event::firstActiveAt(evt->callees->begin(), evt->callees->end(), start);
+            child != evt->callees->end(); ++child)
+        {
+            if ((*child)->enter > stop)
+                break;
+            timeEventToJSON(*child, depth + 1, start, stop, entity_start,
+                            entities, min_span, slice, slice_set,
+                            collective_slice, parent_slice, 
+                            function_ids);
+        }
+    }
+
+}
+
+
+// Instead of how many functions, calculate how much utilization
+json Trace::utilOverview(unsigned long width, bool get_function, unsigned long function, bool logging)
+{
+    float a_pixel = (last_finalize - last_init) / width;
+    std::vector<float> pixels = std::vector<float>();
+    std::vector<float> fxn_pixels = std::vector<float>();
+
+    // Busy time per pixel is the difference of the running totals at its ends
+    for (unsigned long i = 0; i <= width; i++)
+    {
+        double pixel_start = last_init + static_cast<double>(i) * a_pixel;
+        double pixel_end = pixel_start + a_pixel;
+        pixels.push_back(utilization->busyBefore(pixel_end)
+                         - utilization->busyBefore(pixel_start));
+        if (get_function)
+            fxn_pixels.push_back(function_utilization->busyBefore(function, pixel_end)
+                                 - function_utilization->busyBefore(function, pixel_start));
+        else
+            fxn_pixels.push_back(0.0);
+    }
+
+    // Normalize by the number of processors/entities
+    unsigned long long all_time_per_pixel = a_pixel * events->size();
     std::cout << "Events size is " << events->size() << std::endl;
     for (unsigned long i = 0; i <= width; i++) {
         pixels[i] /= all_time_per_pixel;
         fxn_pixels[i] /= all_time_per_pixel;
     }
     json jo;
-    jo["overview"] = pixels;
-    if (get_function) 
+    jo["overview"] = pixels;
+    if (get_function) 
+    {
+        jo["selected_function"] = function;
+        jo["function_overview"] = fxn_pixels;
+    }
+    else
+    {
+        jo["selected_function"] = -1;
+        jo["function_overview"] = std::vector<float>();
+    }
+    return jo;
+}
+
+// Spread of the entities' busy fractions per pixel, so an idle entity
+// and an overloaded one do not average out
+json Trace::imbalanceOverview(unsigned long width, bool logging)
+{
+    json jo;
+    if (width == 0)
+    {
+        jo["error"] = "No width.";
+        return jo;
+    }
+
+    double a_pixel = (last_finalize - last_init) / static_cast<double>(width);
+    std::vector<float> max_pixels(width + 1, 0);
+    std::vector<float> min_pixels(width + 1, 0);
+    std::vector<float> mean_pixels(width + 1, 0);
+    std::vector<float> stddev_pixels(width + 1, 0);
+    RavelUtils::parallelFor(0, width + 1,
+        [this, a_pixel, &max_pixels, &min_pixels, &mean_pixels, &stddev_pixels](unsigned long i) {
+        double pixel_start = last_init + static_cast<double>(i) * a_pixel;
+        ImbalanceTable::Spread spread = imbalance->spread(pixel_start, pixel_start + a_pixel);
+        max_pixels[i] = spread.max;
+        min_pixels[i] = spread.min;
+        mean_pixels[i] = spread.mean;
+        stddev_pixels[i] = spread.stddev;
+    });
+
+    if (logging)
+        std::cout << "Imbalance overview of " << events->size() << " entities" << std::endl;
+
+    jo["max"] = max_pixels;
+    jo["min"] = min_pixels;
+    jo["mean"] = mean_pixels;
+    jo["stddev"] = stddev_pixels;
+    return jo;
+}
+
+json Trace::timeOverview(unsigned long width, bool logging)
+{
+    unsigned long long a_pixel = (last_finalize - last_init) / width;
+    std::vector<unsigned long long> pixels = std::vector<unsigned long long>();
+    //std::cout << "width is " << width << " and start " << last_init << " and stop " << last_finalize << std::endl;
+
+    // Comm events in a pixel are those entering before its end less those
+    // that exited before its start
+    for (unsigned long i = 0; i <= width; i++)
+    {
+        unsigned long long pixel_start = last_init + i * a_pixel;
+        unsigned long long entered = std::lower_bound(comm_enters->begin(), comm_enters->end(),
+                                                      pixel_start + a_pixel) - comm_enters->begin();
+        unsigned long long exited = std::lower_bound(comm_exits->begin(), comm_exits->end(),
+                                                     pixel_start) - comm_exits->begin();
+        pixels.push_back(entered - exited);
+    }
+    json jo(pixels);
+    return jo;
+}
+
+// Log-scale histogram bin of a task length, clamped to the histogram
+unsigned long Trace::lengthPixel(double log_value, double log_micro,
+                                 double log_max_length, unsigned long width)
+{
+    double pixel = trunc(149 * (log_value - log_micro) / (log_max_length - log_micro));
+    if (!(pixel > 0))
+        return 0;
+    if (pixel >= width)
+        return width - 1;
+    return static_cast<unsigned long>(pixel);
+}
+
+// Task length histograms of the top functions. The whole trace is read
+// from every task length, other windows from the histogram tree.
+json Trace::functionRankOverview(unsigned long width, unsigned long long start,
+    unsigned long long stop, bool logging)
+{
+    json jo;
+    bool whole = (start <= min_time && stop >= max_time);
+
+    int rank = 0;
+    std::vector<Function *> top_functions = std::vector<Function *>();
+
+ 
+    //unsigned long a_pixel = (max_task_length + 1) / width;
+    double log_max_length = log10(max_task_length + 1);
+    double log_micro = log10(100000);
+    std::vector<std::vector<unsigned long long> > histograms =
+        std::vector<std::vector<unsigned long long> >();
+    for (int i = 0; i <= 8; i++)
+    {
+        std::vector<unsigned long long> pixels = std::vector<unsigned long long>(width, 0);
+        histograms.push_back(pixels);
+    }
+
+    double log_value = 0;
+    std::map<int, int> function_rows = std::map<int, int>();
+    for (std::vector<Function *>::iterator fxn = function_list->begin();
+        fxn != function_list->end(); ++fxn)
+    {
+        function_rows[(*fxn)->id] = rank;
+
+        // build histogram
+        for (std::vector<unsigned long long>::iterator length = (*fxn)->task_lengths.begin();
+            whole && length != (*fxn)->task_lengths.end(); ++length)
+        {
+            //the_pixel = (*length) / a_pixel;
+            /*
+            if (the_pixel > 50) {
+                std::cout << "The pixel is " << the_pixel << " from " << StringPool::get((*fxn)->name).c_str() << 
+                    " with length " << (*length) << std::endl;
+            }
+            */
+            log_value = log10((*length) + 1);
+            histograms[rank][lengthPixel(log_value, log_micro, log_max_length, width)] += 1;
+        }
+
+        // only take top 8 functions
+        if (rank < 8) {
+            top_functions.push_back(*fxn);
+            rank++;
+        }
+    }
+
+    if (!whole)
+    {
+        std::map<int, std::vector<unsigned long long> > window_histograms;
+        length_histograms->window(start, stop, window_histograms);
+        for (std::map<int, std::vector<unsigned long long> >::iterator fxn = window_histograms.begin();
+             fxn != window_histograms.end(); ++fxn)
+        {
+            std::vector<unsigned long long>& pixels = histograms[function_rows[fxn->first]];
+            for (unsigned int bin = 0; bin < fxn->second.size(); bin++)
+            {
+                if (fxn->second[bin] == 0)
+                    continue;
+                log_value = log10(HistogramTree::binLength(bin) + 1);
+                pixels[lengthPixel(log_value, log_micro, log_max_length, width)] += fxn->second[bin];
+            }
+        }
+    }
+
+    Function other(0, 0, 0);
+    other.count = 0;
+    if (function_list->size() > 8) 
+    {
+        other.count = 1;
+    }
+    top_functions.push_back(&other);
+
+    /*
+    std::vector<Function *>::const_iterator first = function_list->begin();
+    std::vector<Function *>::const_iterator last = function_list->begin() + 9;
+    if (function_list->size() < 9) {
+        last = function_list->end();
+    }
+    std::vector<Function *> top_functions(first, last);
+    */
+    jo["ranked"] = top_functions;
+    jo["histograms"] = histograms;
+    jo["max_task_length"] = max_task_length;
+    
+    
+    return jo;
+}
+
+// Children of a system tree node, or the top of the tree when node is
+// negative, with their rolled up totals
+json Trace::hierarchyJSON(long node, bool logging)
+{
+    json jo;
+    std::vector<json> node_slice = std::vector<json>();
+    std::set<int> function_ids = std::set<int>();
+    unsigned long long span = (last_finalize > last_init) ? last_finalize - last_init : 1;
+
+    if (!system_tree || node >= static_cast<long>(system_tree->size()))
+    {
+        jo["error"] = "No such system tree node.";
+        return jo;
+    }
+
+    std::vector<unsigned long> top = std::vector<unsigned long>();
+    std::vector<unsigned long> * children = &top;
+    if (node >= 0)
+    {
+        children = system_tree->at(node)->children;
+    }
+    else
+    {
+        for (std::vector<SystemNode *>::iterator n = system_tree->begin();
+             n != system_tree->end(); ++n)
+        {
+            if ((*n)->parent < 0)
+                top.push_back((*n)->id);
+        }
+    }
+
+    for (std::vector<unsigned long>::iterator child = children->begin();
+         child != children->end(); ++child)
+    {
+        SystemNode * c = system_tree->at(*child);
+        json jnode(c);
+        jnode["utilization"] = (c->entities > 0) ? c->busy / static_cast<double>(span * c->entities) : 0;
+        if (c->function >= 0)
+            function_ids.insert(c->function);
+        node_slice.push_back(jnode);
+    }
+
+    if (logging)
+        std::cout << "Hierarchy for " << node << " has " << node_slice.size() << " children" << std::endl;
+
+    jo["node"] = node;
+    jo["nodes"] = node_slice;
+    jo["functions"] = functionsJSON(function_ids);
+    return jo;
+}
+
+// Segments, parent and children of one task
+json Trace::taskJSON(uint64_t guid, bool logging)
+{
+    json jo;
+    std::unordered_map<uint64_t, unsigned long>::iterator slot = guid_slots->find(guid);
+    if (guid == 0 || slot == guid_slots->end())
     {
-        jo["selected_function"] = function;
-        jo["function_overview"] = fxn_pixels;
+        jo["error"] = "No such task.";
+        return jo;
     }
-    else
+
+    std::vector<json> segment_slice = std::vector<json>();
+    std::set<int> function_ids = std::set<int>();
+    uint64_t parent = 0;
+    for (unsigned long s = guid_offsets->at(slot->second); s < guid_offsets->at(slot->second + 1); s++)
     {
-        jo["selected_function"] = -1;
-        jo["function_overview"] = std::vector<float>();
+        EventLocation& location = guid_events->at(s);
+        Event * evt = events->at(location.entity)->at(location.index);
+        parent = evt->getParentGUID();
+        function_ids.insert(evt->function);
+        segment_slice.push_back(evt);
+    }
+
+    std::vector<std::string> children = std::vector<std::string>();
+    std::unordered_map<uint64_t, unsigned long>::iterator family = parent_slots->find(guid);
+    if (family != parent_slots->end())
+    {
+        for (unsigned long c = child_offsets->at(family->second); c < child_offsets->at(family->second + 1); c++)
+            children.push_back(std::to_string(child_guids->at(c)));
     }
+
+    if (logging)
+        std::cout << "Task " << guid << " has " << segment_slice.size() << " segments and "
+                  << children.size() << " children" << std::endl;
+
+    jo["guid"] = std::to_string(guid);
+    jo["parent_guid"] = std::to_string(parent);
+    jo["segments"] = segment_slice;
+    jo["children"] = children;
+    jo["functions"] = functionsJSON(function_ids);
     return jo;
 }
 
-json Trace::timeOverview(unsigned long width, bool logging)
+// Calls of one function in the window, on only the entities that make
+// them. Calls shorter than half a pixel are counted instead of sent.
+json Trace::functionEventsJSON(int function,
+    unsigned long long start, unsigned long long stop,
+    unsigned long long entity_start, unsigned long long entities,
+    unsigned long width, bool logging)
 {
-    unsigned long long a_pixel = (last_finalize - last_init) / width;
-    std::vector<unsigned long long> pixels = std::vector<unsigned long long>();
-    //std::cout << "width is " << width << " and start " << last_init << " and stop " << last_finalize << std::endl;
-    for (unsigned long i = 0; i <= width; i++)
+    json jo;
+    if (start > stop || width == 0)
     {
-        pixels.push_back(0);
+        jo["error"] = "Incorrect time range.";
+        return jo;
     }
-    for (unsigned long long entity = 0; entity < events->size(); entity++)
+
+    unsigned long long a_pixel = (stop - start) / width / 2;
+    unsigned long long entity_stop = entity_start + entities;
+    std::vector<json> event_slice = std::vector<json>();
+    unsigned long long hidden = 0;
+
+    const OccurrenceIndex::Run * first, * last;
+    occurrences->runs(function, entity_start, entity_stop, &first, &last);
+    for (const OccurrenceIndex::Run * run = first; run != last; ++run)
     {
-        for (std::vector<Event *>::iterator evt = events->at(entity)->begin();
-             evt != events->at(entity)->end(); ++evt)
+        std::vector<Event *> * entity_events = events->at(run->entity);
+        for (unsigned long p = occurrences->firstActiveAt(*run, start);
+             p < run->end && occurrences->enters[p] < stop; p++)
         {
-            if (!(*evt)->isCommEvent())
+            Event * evt = entity_events->at(occurrences->indices[p]);
+            if (evt->exit <= start)
+                continue;
+            if (evt->exit - evt->enter <= a_pixel)
             {
+                hidden++;
                 continue;
             }
-            unsigned long pixel_start = 0;
-            unsigned long pixel_end = width;
-            if ((*evt)->enter > last_init)
+
+            json jevt(evt);
+            jevt["depth"] = evt->depth;
+            event_slice.push_back(jevt);
+        }
+    }
+
+    if (logging)
+        std::cout << "Function " << function << " has " << event_slice.size()
+                  << " calls in the window and " << hidden << " too short to draw" << std::endl;
+
+    std::set<int> function_ids = std::set<int>();
+    if (functions->count(function))
+        function_ids.insert(function);
+    jo["start"] = start;
+    jo["stop"] = stop;
+    jo["events"] = event_slice;
+    jo["hidden"] = hidden;
+    jo["functions"] = functionsJSON(function_ids);
+    return jo;
+}
+
+// The next call of a function entering after time, the previous one
+// entering before it, or the nth call. Next and previous look at every
+// entity when entity is negative; nth needs an entity.
+json Trace::occurrenceJSON(int function, long entity, unsigned long long time,
+    std::string which, unsigned long n, bool logging)
+{
+    json jo;
+    const OccurrenceIndex::Run * first, * last;
+    if (entity >= 0)
+        occurrences->runs(function, entity, entity + 1, &first, &last);
+    else
+        occurrences->runs(function, 0, events->size(), &first, &last);
+
+    const OccurrenceIndex::Run * found = NULL;
+    unsigned long position = 0;
+    for (const OccurrenceIndex::Run * run = first; run != last; ++run)
+    {
+        if (which.compare("next") == 0)
+        {
+            unsigned long p = occurrences->firstAfter(*run, time);
+            if (p < run->end && (!found || occurrences->enters[p] < occurrences->enters[position]))
             {
-                pixel_start = ((*evt)->enter - last_init) / a_pixel;
+                found = run;
+                position = p;
             }
-            if ((*evt)->exit < last_finalize)
+        }
+        else if (which.compare("prev") == 0)
+        {
+            unsigned long p = occurrences->firstFrom(*run, time);
+            if (p > run->begin && (!found || occurrences->enters[p - 1] > occurrences->enters[position]))
             {
-                pixel_end = ((*evt)->exit - last_init) / a_pixel + 1;
+                found = run;
+                position = p - 1;
             }
-            for (unsigned long i = pixel_start; i < pixel_end; i++)
+        }
+        else if (which.compare("nth") == 0 && entity >= 0)
+        {
+            if (run->begin + n < run->end)
             {
-                pixels[i] += 1;
+                found = run;
+                position = run->begin + n;
             }
         }
     }
-    json jo(pixels);
+
+    if (!found)
+    {
+        jo["error"] = "No such occurrence.";
+        return jo;
+    }
+
+    Event * evt = events->at(found->entity)->at(occurrences->indices[position]);
+    if (logging)
+        std::cout << "Occurrence " << position - found->begin << " of function " << function
+                  << " on entity " << found->entity << " at " << evt->enter << std::endl;
+
+    json jevt(evt);
+    jevt["depth"] = evt->depth;
+    std::set<int> function_ids = std::set<int>();
+    function_ids.insert(evt->function);
+    jo["event"] = jevt;
+    jo["entity"] = found->entity;
+    jo["occurrence"] = position - found->begin;
+    jo["occurrences"] = found->end - found->begin;
+    jo["functions"] = functionsJSON(function_ids);
     return jo;
 }
 
-json Trace::functionRankOverview(unsigned long width, bool logging)
+Trace::SearchFilter::SearchFilter()
+    : function_pattern(""),
+      start(0),
+      stop(ULLONG_MAX),
+      min_duration(0),
+      max_duration(ULLONG_MAX),
+      entity_start(0),
+      entities(ULLONG_MAX),
+      min_depth(INT_MIN),
+      max_depth(INT_MAX),
+      offset(0),
+      limit(100)
+{
+}
+
+// Flag the events of one block of columns that pass the filter.
+// Branch-free apart from the function lookup so the loop vectorizes.
+static void matchColumns(const unsigned long long * enter, const unsigned long long * exit,
+                         const int * function, const int * depth, unsigned int count,
+                         const Trace::SearchFilter& filter,
+                         const std::vector<unsigned char>& wanted,
+                         unsigned char * matched)
+{
+    const unsigned int functions = wanted.size();
+    for (unsigned int i = 0; i < count; i++)
+    {
+        unsigned long long length = exit[i] - enter[i];
+        unsigned int id = static_cast<unsigned int>(function[i]);
+        matched[i] = (enter[i] < filter.stop) & (exit[i] > filter.start)
+                     & (length >= filter.min_duration) & (length <= filter.max_duration)
+                     & (depth[i] >= filter.min_depth) & (depth[i] <= filter.max_depth)
+                     & (id < functions ? wanted[id] : 0);
+    }
+}
+
+// Count the matches on one entity, and collect their enters and indices
+// if matches is given. Scans the plain columns built at load, a chunk's
+// worth at a time.
+unsigned long long Trace::searchEntity(unsigned long entity, const SearchFilter& filter,
+    const std::vector<unsigned char>& wanted,
+    std::vector<std::pair<unsigned long long, unsigned long> > * matches)
+{
+    unsigned long long count = 0;
+    unsigned char matched[search_chunk];
+
+    EventColumns * plain = event_columns->at(entity);
+    for (unsigned long first = 0; first < plain->enters.size(); first += search_chunk)
+    {
+        unsigned int block_count = std::min(static_cast<unsigned long>(search_chunk),
+                                            plain->enters.size() - first);
+        matchColumns(&plain->enters[first], &plain->exits[first], &plain->functions[first],
+                     &plain->depths[first], block_count, filter, wanted, matched);
+        for (unsigned int i = 0; i < block_count; i++)
+        {
+            count += matched[i];
+            if (matches && matched[i])
+                matches->push_back(std::make_pair(plain->enters[first + i], first + i));
+        }
+    }
+    return count;
+}
+
+// Events matching a filter. The function pattern is resolved to IDs once,
+// every entity is counted in parallel, and only the entities holding the
+// requested page are scanned again to collect it.
+json Trace::searchJSON(const SearchFilter& filter, bool logging)
 {
     json jo;
+    std::vector<unsigned char> wanted = std::vector<unsigned char>();
+    try
+    {
+        std::regex pattern(filter.function_pattern);
+        for (std::map<int, Function *>::iterator fxn = functions->begin();
+             fxn != functions->end(); ++fxn)
+        {
+            if (fxn->first < 0 || (!filter.function_pattern.empty()
+                && !std::regex_search(StringPool::get(fxn->second->name), pattern)))
+            {
+                continue;
+            }
+            if (static_cast<unsigned long>(fxn->first) >= wanted.size())
+                wanted.resize(fxn->first + 1, 0);
+            wanted[fxn->first] = 1;
+        }
+    }
+    catch (std::regex_error& e)
+    {
+        jo["error"] = std::string("Bad function pattern: ") + e.what();
+        return jo;
+    }
 
-    int rank = 0;
-    std::vector<Function *> top_functions = std::vector<Function *>();
+    unsigned long long entity_start = std::min(filter.entity_start,
+                                               static_cast<unsigned long long>(events->size()));
+    unsigned long long entity_stop = entity_start + std::min(filter.entities,
+                                                             events->size() - entity_start);
+    std::vector<unsigned long long> counts(entity_stop - entity_start, 0);
+    if (!wanted.empty())
+    {
+        RavelUtils::parallelFor(entity_start, entity_stop,
+            [this, &filter, &wanted, &counts, entity_start](unsigned long entity) {
+                counts[entity - entity_start] = searchEntity(entity, filter, wanted, NULL);
+            });
+    }
 
- 
-    //unsigned long a_pixel = (max_task_length + 1) / width;
-    double log_max_length = log10(max_task_length + 1);
-    double log_micro = log10(100000);
-    std::vector<std::vector<unsigned long long> > histograms =
-        std::vector<std::vector<unsigned long long> >();
-    for (int i = 0; i <= 8; i++)
+    unsigned long long total = 0;
+    for (std::vector<unsigned long long>::iterator count = counts.begin();
+         count != counts.end(); ++count)
     {
-        std::vector<unsigned long long> pixels = std::vector<unsigned long long>(width, 0);
-        histograms.push_back(pixels);
+        total += *count;
     }
 
-    unsigned long the_pixel = 0;
-    double log_value = 0;
-    for (std::vector<Function *>::iterator fxn = function_list->begin();
-        fxn != function_list->end(); ++fxn)
+    std::vector<json> match_slice = std::vector<json>();
+    std::set<int> function_ids = std::set<int>();
+    std::vector<std::pair<unsigned long long, unsigned long> > matches
+        = std::vector<std::pair<unsigned long long, unsigned long> >();
+    unsigned long long skip = filter.offset;
+    unsigned long long needed = std::min(filter.limit, max_search_limit);
+    for (unsigned long long entity = entity_start; entity < entity_stop && needed > 0; entity++)
     {
-        // build histogram
-        for (std::vector<unsigned long long>::iterator length = (*fxn)->task_lengths.begin();
-            length != (*fxn)->task_lengths.end(); ++length)
+        unsigned long long count = counts[entity - entity_start];
+        if (skip >= count)
         {
-            //the_pixel = (*length) / a_pixel;
-            /*
-            if (the_pixel > 50) {
-                std::cout << "The pixel is " << the_pixel << " from " << (*fxn)->name.c_str() << 
-                    " with length " << (*length) << std::endl;
+            skip -= count;
+            continue;
+        }
+
+        matches.clear();
+        searchEntity(entity, filter, wanted, &matches);
+        unsigned long long end = std::min(skip + needed, count);
+        std::partial_sort(matches.begin(), matches.begin() + end, matches.end());
+        for (unsigned long long m = skip; m < end; m++)
+        {
+            Event * evt = events->at(entity)->at(matches[m].second);
+            json jevt(evt);
+            jevt["depth"] = evt->depth;
+            function_ids.insert(evt->function);
+            match_slice.push_back(jevt);
+        }
+        needed -= end - skip;
+        skip = 0;
+    }
+
+    if (logging)
+        std::cout << "Search matched " << total << " events, sending " << match_slice.size() << std::endl;
+
+    jo["count"] = total;
+    jo["offset"] = filter.offset;
+    jo["matches"] = match_slice;
+    jo["functions"] = functionsJSON(function_ids);
+    return jo;
+}
+
+// The k longest tasks of one function, or of all when function is
+// negative, overlapping start to stop. The whole trace is answered from
+// the lists ranked at load, windows of all functions from the entities'
+// block summaries and windows of one function from the summaries of its
+// calls on each entity.
+json Trace::longestJSON(int function, unsigned long long start, unsigned long long stop,
+    unsigned long k, bool logging)
+{
+    json jo;
+    k = std::min(k, static_cast<unsigned long>(LongestTasks::summary_size));
+
+    std::vector<LongestTasks::Task> heap = std::vector<LongestTasks::Task>();
+    if (start <= min_time && stop >= max_time)
+    {
+        std::vector<LongestTasks::Task> * ranked = longest;
+        if (function >= 0)
+        {
+            std::map<int, std::vector<LongestTasks::Task> >::iterator fxn
+                = longest_by_function->find(function);
+            ranked = (fxn != longest_by_function->end()) ? &(fxn->second) : &heap;
+        }
+        heap.assign(ranked->begin(), ranked->begin() + std::min(k, static_cast<unsigned long>(ranked->size())));
+    }
+    else if (function < 0)
+    {
+        std::vector<std::vector<LongestTasks::Task> > entity_heaps(events->size());
+        RavelUtils::parallelFor(0, events->size(), [this, &entity_heaps, start, stop, k](unsigned long entity) {
+            longest_tasks->at(entity)->window(entity, events->at(entity), start, stop, k,
+                                              entity_heaps[entity]);
+        });
+        for (std::vector<std::vector<LongestTasks::Task> >::iterator entity_heap = entity_heaps.begin();
+             entity_heap != entity_heaps.end(); ++entity_heap)
+        {
+            for (std::vector<LongestTasks::Task>::iterator task = entity_heap->begin();
+                 task != entity_heap->end(); ++task)
+            {
+                LongestTasks::keep(heap, *task, k);
             }
-            */
-            log_value = log10((*length) + 1);
-            the_pixel = static_cast<unsigned long>(
-                trunc(149 * (log_value - log_micro) / (log_max_length - log_micro)));
+        }
+        LongestTasks::finish(heap);
+    }
+    else
+    {
+        const OccurrenceIndex::Run * first, * last;
+        occurrences->runs(function, 0, events->size(), &first, &last);
+        for (const OccurrenceIndex::Run * run = first; run != last; ++run)
+            longest_calls->window(*run, occurrences, events, start, stop, k, heap);
+        LongestTasks::finish(heap);
+    }
+
+    std::vector<json> task_slice = std::vector<json>();
+    std::set<int> function_ids = std::set<int>();
+    for (std::vector<LongestTasks::Task>::iterator task = heap.begin(); task != heap.end(); ++task)
+    {
+        Event * evt = events->at(task->entity)->at(task->index);
+        json jevt(evt);
+        jevt["length"] = task->length;
+        jevt["depth"] = evt->depth;
+        function_ids.insert(evt->function);
+        task_slice.push_back(jevt);
+    }
+
+    if (logging)
+        std::cout << "Longest " << task_slice.size() << " tasks of function " << function << std::endl;
 
-            histograms[rank][the_pixel] += 1;
+    jo["tasks"] = task_slice;
+    jo["functions"] = functionsJSON(function_ids);
+    return jo;
+}
+
+// Inclusive time, exclusive time and overlapping call count of every
+// function over start to stop and the entity range, from each entity's
+// function profile
+json Trace::profileJSON(unsigned long long start, unsigned long long stop,
+    unsigned long long entity_start, unsigned long long entities, bool logging)
+{
+    json jo;
+    entity_start = std::min(entity_start, static_cast<unsigned long long>(events->size()));
+    unsigned long long entity_stop = entity_start + std::min(entities,
+                                                             events->size() - entity_start);
+    if (entity_start >= entity_stop || start >= stop)
+    {
+        jo["error"] = "Empty window";
+        return jo;
+    }
+
+    std::vector<std::map<int, FunctionProfile::Totals> > entity_totals(entity_stop - entity_start);
+    RavelUtils::parallelFor(entity_start, entity_stop, [this, &entity_totals, entity_start, start, stop](unsigned long entity) {
+        function_profiles->at(entity)->window(start, stop, entity_totals[entity - entity_start]);
+    });
+
+    std::map<int, FunctionProfile::Totals> totals = std::map<int, FunctionProfile::Totals>();
+    for (std::vector<std::map<int, FunctionProfile::Totals> >::iterator entity = entity_totals.begin();
+         entity != entity_totals.end(); ++entity)
+    {
+        for (std::map<int, FunctionProfile::Totals>::iterator fxn = entity->begin();
+             fxn != entity->end(); ++fxn)
+        {
+            FunctionProfile::Totals& total = totals[fxn->first];
+            total.inclusive += fxn->second.inclusive;
+            total.exclusive += fxn->second.exclusive;
+            total.count += fxn->second.count;
         }
+    }
 
-        // only take top 8 functions
-        if (rank < 8) {
-            top_functions.push_back(*fxn);
-            rank++;
+    std::vector<std::pair<unsigned long long, int> > ranked = std::vector<std::pair<unsigned long long, int> >();
+    for (std::map<int, FunctionProfile::Totals>::iterator fxn = totals.begin();
+         fxn != totals.end(); ++fxn)
+    {
+        ranked.push_back(std::make_pair(fxn->second.exclusive, fxn->first));
+    }
+    std::sort(ranked.begin(), ranked.end(), std::greater<std::pair<unsigned long long, int> >());
+
+    std::vector<json> profile_slice = std::vector<json>();
+    std::set<int> function_ids = std::set<int>();
+    for (std::vector<std::pair<unsigned long long, int> >::iterator fxn = ranked.begin();
+         fxn != ranked.end(); ++fxn)
+    {
+        const FunctionProfile::Totals& total = totals[fxn->second];
+        json jfxn;
+        jfxn["function"] = fxn->second;
+        jfxn["inclusive"] = total.inclusive;
+        jfxn["exclusive"] = total.exclusive;
+        jfxn["count"] = total.count;
+        function_ids.insert(fxn->second);
+        profile_slice.push_back(jfxn);
+    }
+
+    if (logging)
+        std::cout << "Profile of " << profile_slice.size() << " functions" << std::endl;
+
+    jo["profile"] = profile_slice;
+    jo["functions"] = functionsJSON(function_ids);
+    return jo;
+}
+
+// Flame graph of the calling-context tree over start to stop and the
+// entity range. The whole trace is read from the node totals, windows
+// from each node's sorted calls, with exclusive time what the node's
+// children do not cover.
+json Trace::flameGraphJSON(unsigned long long start, unsigned long long stop,
+    unsigned long long entity_start, unsigned long long entities, bool logging)
+{
+    json jo;
+    entity_start = std::min(entity_start, static_cast<unsigned long long>(events->size()));
+    unsigned long long entity_stop = entity_start + std::min(entities,
+                                                             events->size() - entity_start);
+    if (entity_start >= entity_stop || start >= stop)
+    {
+        jo["error"] = "Empty window";
+        return jo;
+    }
+
+    std::vector<CallingContextTree::Node> nodes = contexts->nodes;
+    if (start > min_time || stop < max_time || entity_start > 0 || entity_stop < events->size())
+    {
+        RavelUtils::parallelFor(1, nodes.size(), [this, &nodes, start, stop, entity_start, entity_stop](unsigned long n) {
+            contexts->window(n, start, stop, entity_start, entity_stop,
+                             &(nodes[n].count), &(nodes[n].inclusive));
+        });
+
+        // Children come after their parents
+        std::vector<unsigned long long> child_time(nodes.size(), 0);
+        for (unsigned long n = nodes.size() - 1; n > 0; n--)
+        {
+            child_time[nodes[n].parent] += nodes[n].inclusive;
+            nodes[n].exclusive = (nodes[n].inclusive > child_time[n]) ? nodes[n].inclusive - child_time[n] : 0;
         }
+        nodes[0].inclusive = child_time[0];
     }
 
-    Function * other = new Function(0, "", 0);
-    other->count = 0;
-    if (function_list->size() > 8) 
+    std::vector<json> node_slice = std::vector<json>();
+    std::set<int> function_ids = std::set<int>();
+    for (unsigned long n = 0; n < nodes.size(); n++)
     {
-        other->count = 1;
+        if (n > 0 && nodes[n].count == 0)
+            continue;
+        json jnode;
+        jnode["id"] = n;
+        jnode["parent"] = nodes[n].parent;
+        jnode["function"] = nodes[n].function;
+        jnode["depth"] = nodes[n].depth;
+        jnode["count"] = nodes[n].count;
+        jnode["inclusive"] = nodes[n].inclusive;
+        jnode["exclusive"] = nodes[n].exclusive;
+        if (nodes[n].function >= 0)
+            function_ids.insert(nodes[n].function);
+        node_slice.push_back(jnode);
     }
-    top_functions.push_back(other);
 
-    /*
-    std::vector<Function *>::const_iterator first = function_list->begin();
-    std::vector<Function *>::const_iterator last = function_list->begin() + 9;
-    if (function_list->size() < 9) {
-        last = function_list->end();
+    if (logging)
+        std::cout << "Flame graph of " << node_slice.size() << " contexts" << std::endl;
+
+    jo["nodes"] = node_slice;
+    jo["functions"] = functionsJSON(function_ids);
+    return jo;
+}
+
+// Latency and size histograms and per sender and receiver totals of the
+// messages the entity range sent, or received, from start to stop
+json Trace::messageStatsJSON(unsigned long long start, unsigned long long stop,
+    unsigned long long entity_start, unsigned long long entities,
+    bool received, unsigned long limit, bool logging)
+{
+    json jo;
+    entity_start = std::min(entity_start, static_cast<unsigned long long>(events->size()));
+    unsigned long long entity_stop = entity_start + std::min(entities,
+                                                             events->size() - entity_start);
+    if (entity_start >= entity_stop || start >= stop)
+    {
+        jo["error"] = "Empty window";
+        return jo;
     }
-    std::vector<Function *> top_functions(first, last);
-    */
-    jo["ranked"] = top_functions;
-    jo["histograms"] = histograms;
-    jo["max_task_length"] = max_task_length;
-    
-    
+
+    std::vector<MessageStats::Summary> summaries(entity_stop - entity_start);
+    RavelUtils::parallelFor(entity_start, entity_stop,
+        [this, &summaries, entity_start, received, start, stop](unsigned long entity) {
+        message_stats->window(entity, received, start, stop, summaries[entity - entity_start]);
+    });
+
+    struct PairTotals {
+        unsigned long sender;
+        unsigned long receiver;
+        MessageStats::Peer totals;
+        bool operator<(const PairTotals& other) const
+        {
+            if (totals.count != other.totals.count)
+                return totals.count > other.totals.count;
+            if (sender != other.sender)
+                return sender < other.sender;
+            return receiver < other.receiver;
+        }
+    };
+    MessageStats::Summary total = MessageStats::Summary();
+    std::vector<PairTotals> pairs = std::vector<PairTotals>();
+    unsigned long long count = 0, bytes = 0, latency = 0, max_latency = 0;
+    for (unsigned long entity = entity_start; entity < entity_stop; entity++)
+    {
+        MessageStats::Summary& summary = summaries[entity - entity_start];
+        for (unsigned int b = 0; b < MessageStats::bins; b++)
+        {
+            total.latencies[b] += summary.latencies[b];
+            total.sizes[b] += summary.sizes[b];
+        }
+        for (std::map<unsigned long, MessageStats::Peer>::iterator peer = summary.peers.begin();
+             peer != summary.peers.end(); ++peer)
+        {
+            PairTotals pair = { received ? peer->first : entity,
+                                received ? entity : peer->first,
+                                peer->second };
+            pairs.push_back(pair);
+            count += peer->second.count;
+            bytes += peer->second.bytes;
+            latency += peer->second.latency;
+            max_latency = std::max(max_latency, peer->second.max_latency);
+        }
+    }
+
+    limit = std::min(limit, static_cast<unsigned long>(pairs.size()));
+    std::partial_sort(pairs.begin(), pairs.begin() + limit, pairs.end());
+    std::vector<json> pair_slice = std::vector<json>();
+    for (unsigned long p = 0; p < limit; p++)
+    {
+        json jpair;
+        jpair["sender"] = pairs[p].sender;
+        jpair["receiver"] = pairs[p].receiver;
+        jpair["count"] = pairs[p].totals.count;
+        jpair["bytes"] = pairs[p].totals.bytes;
+        jpair["mean_latency"] = pairs[p].totals.latency / static_cast<double>(pairs[p].totals.count);
+        jpair["max_latency"] = pairs[p].totals.max_latency;
+        pair_slice.push_back(jpair);
+    }
+
+    std::vector<json> latency_slice = std::vector<json>();
+    std::vector<json> size_slice = std::vector<json>();
+    for (unsigned int b = 0; b < MessageStats::bins; b++)
+    {
+        if (total.latencies[b] > 0)
+            latency_slice.push_back({ {"floor", MessageStats::binFloor(b)}, {"count", total.latencies[b]} });
+        if (total.sizes[b] > 0)
+            size_slice.push_back({ {"floor", MessageStats::binFloor(b)}, {"count", total.sizes[b]} });
+    }
+
+    if (logging)
+        std::cout << "Message stats of " << count << " messages in " << pairs.size() << " pairs" << std::endl;
+
+    jo["count"] = count;
+    jo["bytes"] = bytes;
+    jo["mean_latency"] = (count > 0) ? latency / static_cast<double>(count) : 0;
+    jo["max_latency"] = max_latency;
+    jo["latency"] = latency_slice;
+    jo["size"] = size_slice;
+    jo["pairs"] = pair_slice;
+    jo["pair_count"] = pairs.size();
+    return jo;
+}
+
+// The k longest idle gaps within start to stop on the entity range,
+// ranked by how much of them is in the window
+json Trace::idleGapsJSON(unsigned long long start, unsigned long long stop,
+    unsigned long long entity_start, unsigned long long entities,
+    unsigned long k, bool logging)
+{
+    json jo;
+    entity_start = std::min(entity_start, static_cast<unsigned long long>(roots->size()));
+    unsigned long long entity_stop = entity_start + std::min(entities,
+                                                             roots->size() - entity_start);
+    if (entity_start >= entity_stop || start >= stop)
+    {
+        jo["error"] = "Empty window";
+        return jo;
+    }
+    k = std::min(k, max_gap_limit);
+
+    std::vector<std::vector<GapIndex::Gap> > entity_heaps(entity_stop - entity_start);
+    RavelUtils::parallelFor(entity_start, entity_stop,
+        [this, &entity_heaps, entity_start, start, stop, k](unsigned long entity) {
+        idle_gaps->longest(entity, start, stop, k, entity_heaps[entity - entity_start]);
+    });
+    std::vector<GapIndex::Gap> heap = std::vector<GapIndex::Gap>();
+    for (std::vector<std::vector<GapIndex::Gap> >::iterator entity_heap = entity_heaps.begin();
+         entity_heap != entity_heaps.end(); ++entity_heap)
+    {
+        for (std::vector<GapIndex::Gap>::iterator gap = entity_heap->begin();
+             gap != entity_heap->end(); ++gap)
+        {
+            GapIndex::keep(heap, *gap, k);
+        }
+    }
+    GapIndex::finish(heap);
+
+    std::vector<json> gap_slice = std::vector<json>();
+    for (std::vector<GapIndex::Gap>::iterator gap = heap.begin(); gap != heap.end(); ++gap)
+    {
+        json jgap;
+        jgap["entity"] = gap->entity;
+        jgap["start"] = gap->start;
+        jgap["length"] = gap->length;
+        jgap["inside"] = gap->inside;
+        gap_slice.push_back(jgap);
+    }
+
+    if (logging)
+        std::cout << "Longest " << gap_slice.size() << " idle gaps" << std::endl;
+
+    jo["gaps"] = gap_slice;
+    return jo;
+}
+
+// Idle time and fraction of each entity in the window, with the count,
+// total and longest of its gaps over the whole trace
+json Trace::idleFractionJSON(unsigned long long start, unsigned long long stop,
+    unsigned long long entity_start, unsigned long long entities, bool logging)
+{
+    json jo;
+    entity_start = std::min(entity_start, static_cast<unsigned long long>(roots->size()));
+    unsigned long long entity_stop = entity_start + std::min(entities,
+                                                             roots->size() - entity_start);
+    start = std::max(start, idle_gaps->start);
+    stop = std::min(stop, idle_gaps->stop);
+    if (entity_start >= entity_stop || start >= stop)
+    {
+        jo["error"] = "Empty window";
+        return jo;
+    }
+
+    std::vector<json> entity_slice = std::vector<json>();
+    unsigned long long total_idle = 0;
+    for (unsigned long entity = entity_start; entity < entity_stop; entity++)
+    {
+        unsigned long long idle = idle_gaps->idleTime(entity, start, stop);
+        GapIndex::Summary summary = idle_gaps->summary(entity);
+        json jentity;
+        jentity["entity"] = entity;
+        jentity["idle"] = idle;
+        jentity["fraction"] = idle / static_cast<double>(stop - start);
+        jentity["gaps"] = summary.count;
+        jentity["total_idle"] = summary.total;
+        jentity["longest_gap"] = summary.longest;
+        jentity["mean_gap"] = (summary.count > 0) ? summary.total / static_cast<double>(summary.count) : 0;
+        entity_slice.push_back(jentity);
+        total_idle += idle;
+    }
+
+    if (logging)
+        std::cout << "Idle fraction of " << entity_slice.size() << " entities" << std::endl;
+
+    jo["start"] = start;
+    jo["stop"] = stop;
+    jo["idle"] = total_idle;
+    jo["fraction"] = total_idle / static_cast<double>(stop - start) / (entity_stop - entity_start);
+    jo["entities"] = entity_slice;
+    return jo;
+}
+
+// Entities of the range that are between root tasks at time, with the
+// gap each is in
+json Trace::idleAtJSON(unsigned long long time,
+    unsigned long long entity_start, unsigned long long entities, bool logging)
+{
+    json jo;
+    entity_start = std::min(entity_start, static_cast<unsigned long long>(roots->size()));
+    unsigned long long entity_stop = entity_start + std::min(entities,
+                                                             roots->size() - entity_start);
+
+    std::vector<json> entity_slice = std::vector<json>();
+    GapIndex::Gap gap;
+    for (unsigned long entity = entity_start; entity < entity_stop; entity++)
+    {
+        if (!idle_gaps->idleAt(entity, time, &gap))
+            continue;
+        json jgap;
+        jgap["entity"] = entity;
+        jgap["start"] = gap.start;
+        jgap["length"] = gap.length;
+        entity_slice.push_back(jgap);
+    }
+
+    if (logging)
+        std::cout << entity_slice.size() << " entities idle at " << time << std::endl;
+
+    jo["time"] = time;
+    jo["entities"] = entity_slice;
+    jo["count"] = entity_slice.size();
     return jo;
 }
 
@@ -705,12 +2731,12 @@ json Trace::initJSON(unsigned long width, unsigned long overview_width,
     {
         span = a_pixel * 5;
     }
-    json jo = timeToJSON(last_init, span + last_init, 0, roots->size(), width, 0, 0, 0, 0, logging);
+    json jo = timeToJSON(last_init, span + last_init, 0, roots->size(), width, 0, 0, 0, 0, 0, logging);
     json overview = utilOverview(overview_width, false, 0, logging);
     jo["overview"] = overview["overview"];
     jo["function_overview"] = overview["function_overview"];
     jo["selected_function"] = overview["selected_function"];
-    jo["colorkey"] = functionRankOverview(function_width, logging);
+    jo["colorkey"] = functionRankOverview(function_width, min_time, max_time, logging);
 
     return jo;
 }
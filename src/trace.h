@@ -7,10 +7,14 @@
 #include <queue>
 #include <stack>
 #include <set>
+#include <unordered_map>
 #include <memory>
 #include <ctime>
 #include <stdint.h>
 #include <nlohmann/json.hpp>
+#include "arena.h"
+#include "importoptions.h"
+#include "longesttasks.h"
 
 using json = nlohmann::json;
 
@@ -22,6 +26,19 @@ class EntityGroup;
 class PrimaryEntityGroup;
 class OTFCollective;
 class CollectiveRecord;
+class EventColumns;
+class LODPyramid;
+class BusyProfile;
+class SystemNode;
+class OccurrenceIndex;
+class FunctionProfile;
+class CallingContextTree;
+class HistogramTree;
+class ImbalanceTable;
+class FunctionBusyTable;
+class RowTable;
+class MessageStats;
+class GapIndex;
 
 class Trace
 {
@@ -31,10 +48,12 @@ public:
 
     void preprocess();
     Event * findEvent(int entity, unsigned long long time);
+    unsigned long long selfTime(Event * evt);
     json timeToJSON(unsigned long long start, unsigned long long stop,
                     unsigned long long entity_start,
                     unsigned long long entities,
                     unsigned long width,
+                    unsigned long rows,
                     unsigned long long taskid,
                     unsigned long long task_time,
                     unsigned long traceback_state,
@@ -48,7 +67,22 @@ public:
     json utilOverview(unsigned long width, 
                       bool get_function, unsigned long function,
                       bool logging);
-    json functionRankOverview(unsigned long width, bool logging);
+    json imbalanceOverview(unsigned long width, bool logging);
+    json functionRankOverview(unsigned long width, unsigned long long start,
+                              unsigned long long stop, bool logging);
+    json hierarchyJSON(long node, bool logging);
+    json taskJSON(uint64_t guid, bool logging);
+    json functionEventsJSON(int function,
+                            unsigned long long start, unsigned long long stop,
+                            unsigned long long entity_start,
+                            unsigned long long entities,
+                            unsigned long width,
+                            bool logging);
+    json occurrenceJSON(int function, long entity, unsigned long long time,
+                        std::string which, unsigned long n,
+                        bool logging);
+    CommEvent * messageSender(const Message * msg);
+    CommEvent * messageReceiver(const Message * msg);
     std::string name;
     std::string fullpath;
     int num_entities;
@@ -56,6 +90,68 @@ public:
     int units;
     int max_depth;
     uint64_t totalTime;
+    OTFImportOptions options;
+
+    // Owns events, their callee lists and metrics, so destroying the
+    // trace releases a few large regions
+    Arena * arena;
+
+    // What searchJSON matches: events overlapping start to stop on
+    // entity_start up to entity_start + entities, whose function name
+    // matches the pattern (any if empty) and whose duration and depth
+    // are within the bounds. Matches are paged by offset and limit in
+    // entity then enter order.
+    struct SearchFilter {
+        SearchFilter();
+        std::string function_pattern;
+        unsigned long long start;
+        unsigned long long stop;
+        unsigned long long min_duration;
+        unsigned long long max_duration;
+        unsigned long long entity_start;
+        unsigned long long entities;
+        int min_depth;
+        int max_depth;
+        unsigned long offset;
+        unsigned long limit;
+    };
+    json searchJSON(const SearchFilter& filter, bool logging);
+    json longestJSON(int function,
+                     unsigned long long start, unsigned long long stop,
+                     unsigned long k,
+                     bool logging);
+    json profileJSON(unsigned long long start, unsigned long long stop,
+                     unsigned long long entity_start,
+                     unsigned long long entities,
+                     bool logging);
+    json flameGraphJSON(unsigned long long start, unsigned long long stop,
+                        unsigned long long entity_start,
+                        unsigned long long entities,
+                        bool logging);
+    json messageStatsJSON(unsigned long long start, unsigned long long stop,
+                          unsigned long long entity_start,
+                          unsigned long long entities,
+                          bool received, unsigned long limit,
+                          bool logging);
+    json idleGapsJSON(unsigned long long start, unsigned long long stop,
+                      unsigned long long entity_start,
+                      unsigned long long entities,
+                      unsigned long k,
+                      bool logging);
+    json idleFractionJSON(unsigned long long start, unsigned long long stop,
+                          unsigned long long entity_start,
+                          unsigned long long entities,
+                          bool logging);
+    json idleAtJSON(unsigned long long time,
+                    unsigned long long entity_start,
+                    unsigned long long entities,
+                    bool logging);
+
+    // Where an event lives in events
+    struct EventLocation {
+        unsigned long entity;
+        unsigned long index;
+    };
 
     std::vector<std::string> * metrics;
     std::map<std::string, std::string> * metric_units;
@@ -66,6 +162,7 @@ public:
 
     std::map<int, PrimaryEntityGroup *> * primaries;
     PrimaryEntityGroup * processingElements;
+    std::vector<SystemNode *> * system_tree; // Machine hierarchy, NULL if not in the trace
     std::map<int, EntityGroup *> * entitygroups;
     std::map<int, OTFCollective *> * collective_definitions;
 
@@ -74,8 +171,97 @@ public:
 
     std::vector<std::vector<Event *> *> * events; // This is going to be by entities
     std::vector<std::vector<Event *> *> * roots; // Roots of call trees per pe
+    // Position of each entity's first event when all entities' events are
+    // laid end to end, with the total at the end
+    std::vector<unsigned long> * event_offsets;
+
+    // All messages, contiguous and sorted by send time. The messages of
+    // event i on an entity are message_lists[entity] positions
+    // message_offsets[entity][i] up to message_offsets[entity][i + 1].
+    std::vector<Message> * messages;
+    std::vector<std::vector<unsigned long> *> * message_offsets;
+    std::vector<std::vector<unsigned long> *> * message_lists;
+    // Matched messages with an end on each entity, as positions in
+    // messages in send order from message_entity_offsets[entity], with
+    // the running maximum recvtime over each entity's run. A window query
+    // visits only its entities' runs and skips the messages in them
+    // received before it starts.
+    std::vector<unsigned long> * message_entity_offsets;
+    std::vector<unsigned long> * message_entity_list;
+    std::vector<unsigned long long> * message_reach;
+    // Latency and size distributions by entity for windows
+    MessageStats * message_stats;
+
+    // Whole-trace critical path in dependency order, with the running
+    // maximum exit and the minimum enter of the rest of the path from each
+    // step for window queries
+    std::vector<Event *> * critical_path;
+    std::vector<unsigned long long> * critical_reach;
+    std::vector<unsigned long long> * critical_floor;
+
+    // Plain per-entity columns for searches
+    std::vector<EventColumns *> * event_columns;
+
+    // Level-of-detail summaries for zoomed out windows, one per entity,
+    // with finest buckets of 1 << lod_shift ticks
+    std::vector<LODPyramid *> * lod;
+    int lod_shift;
+    int lod_levels;
 
-    std::map<uint64_t, std::vector<unsigned long long> *> * guidMap;
+    // Busy time, events and leading function of every entity, for rows
+    // merging adjacent entities
+    RowTable * row_table;
+
+    // Calls of each function on each entity in enter order
+    OccurrenceIndex * occurrences;
+
+    // The longest tasks of the whole trace and of each function, longest
+    // first, and per entity and per occurrence run summaries for windows
+    std::vector<LongestTasks::Task> * longest;
+    std::map<int, std::vector<LongestTasks::Task> > * longest_by_function;
+    std::vector<LongestTasks *> * longest_tasks;
+    LongestTasks * longest_calls;
+
+    // Inclusive and exclusive time of each function per entity, for the
+    // profile of any window
+    std::vector<FunctionProfile *> * function_profiles;
+
+    // Self time of each event, by position from event_offsets
+    std::vector<unsigned long long> * self_times;
+
+    // Time each comm event spent waiting on a late peer and the kind of
+    // wait, by position from event_offsets
+    std::vector<unsigned long long> * wait_times;
+    std::vector<unsigned char> * wait_kinds;
+
+    // Call trees of all entities merged by call path
+    CallingContextTree * contexts;
+
+    // Task length histograms per function for windows
+    HistogramTree * length_histograms;
+
+    // Gaps between each entity's root tasks from min_time to max_time
+    GapIndex * idle_gaps;
+
+    // Overview tables from last_init to last_finalize: busy time of all
+    // events, each entity's busy fraction, and comm event enters and exits
+    // sorted, and the busy time of every function, sparse over the same bins.
+    BusyProfile * utilization;
+    FunctionBusyTable * function_utilization;
+    ImbalanceTable * imbalance;
+    std::vector<unsigned long long> * comm_enters;
+    std::vector<unsigned long long> * comm_exits;
+
+    // Events by GUID, for HPX traces. The slot of a GUID gives its run
+    // guid_offsets[slot] up to guid_offsets[slot + 1] of guid_events, the
+    // segments of the task in enter order. Child GUIDs are kept the same
+    // way under the slot of their parent GUID.
+    std::unordered_map<uint64_t, unsigned long> * guid_slots;
+    std::vector<unsigned long> * guid_offsets;
+    std::vector<EventLocation> * guid_events;
+    std::unordered_map<uint64_t, unsigned long> * parent_slots;
+    std::vector<unsigned long> * child_offsets;
+    std::vector<uint64_t> * child_guids;
     std::vector<Function *> * function_list; // List of functions sorted by count executed
 
     int mpi_group; // functionGroup index of "MPI" functions
@@ -88,48 +274,108 @@ public:
 
 private:
     bool isProcessed; // Partitions exist
+
+    // Events expanded by the running traceback, by position from
+    // event_offsets. Only the expanded bits are cleared afterwards.
+    std::vector<bool> * traceback_visited;
+    void indexCallTrees();
+    void buildPyramids();
+    void buildOverviews();
+    void indexSelfTimes();
+    void indexMessages();
+    void indexWaitStates();
+    void indexGUIDs();
+    void rankTasks();
+    void buildProfiles();
+    unsigned long long searchEntity(unsigned long entity, const SearchFilter& filter,
+                                    const std::vector<unsigned char>& wanted,
+                                    std::vector<std::pair<unsigned long long, unsigned long> > * matches);
+    void findCriticalPath();
+    void rollUpSystemTree();
+    void summarizeEntity(SystemNode * leaf);
+    template <typename Iterator>
+    static void setPrefixExit(Iterator begin, Iterator end);
+    static unsigned long lengthPixel(double log_value, double log_micro,
+                                     double log_max_length, unsigned long width);
+    void addAggregateJSON(Event * evt, json& jevt);
+    json eventJSON(Event * evt);
+    json functionsJSON(std::set<int>& function_ids);
+    void addEventJSON(Event * evt, int depth,
+                      std::vector<json>& slice,
+                      std::set<uint64_t>& slice_set,
+                      std::vector<std::vector<json> >& parent_slice,
+                      std::set<int>& function_ids);
+    void messagesJSON(unsigned long long start, unsigned long long stop,
+                      unsigned long long entity_start,
+                      unsigned long long entity_stop,
+                      std::vector<json>& msg_slice);
+    void criticalPathJSON(unsigned long long start, unsigned long long stop,
+                          unsigned long long entity_start,
+                          unsigned long long entity_stop,
+                          unsigned long long min_span,
+                          std::vector<json>& critical_slice,
+                          std::set<int>& function_ids);
+    void rowsJSON(unsigned long long start, unsigned long long stop,
+                  unsigned long long entity_start,
+                  unsigned long long entities,
+                  unsigned long width, unsigned long rows,
+                  std::set<int>& function_ids,
+                  json& jo);
+    void densityJSON(unsigned long long entity,
+                     unsigned long long start, unsigned long long stop,
+                     int level,
+                     std::vector<json>& density_slice,
+                     std::set<int>& function_ids);
     void timeEventToJSON(Event * evt, int depth,
                          unsigned long long start, unsigned long long stop,
                          unsigned long long entity_start,
                          unsigned long long entities,
                          unsigned long long min_span,
-                         unsigned long long taskid,
                          std::vector<json>& slice,
                          std::set<uint64_t>& slice_set,
-                         std::vector<json>& msg_slice,
                          std::vector<json>& collective_slice,
                          std::vector<std::vector<json> >& parent_slice,
-                         std::map<std::string, Function *>& function_names);
-    void eventTraceBackJSON(Event * evt, unsigned long long start,
-                            unsigned long long stop, 
-                            unsigned long long entity_start, unsigned long long entities,
-                            unsigned long long min_span, 
-                            unsigned long long taskid, unsigned long long task_time,
-                            bool full_traceback,
-                            std::vector<json>& msg_slice, 
-                            std::vector<json>& evt_slice,
-                            std::set<uint64_t>& evt_set,
-                            std::map<std::string, Function *>& function_names,
-                            bool logging);
-    void msgTraceBackJSON(CommEvent * evt, int depth, bool sibling, bool full_tracekbac, 
-                          Message * last,
-                          unsigned long long start, unsigned long long stop, 
-                          unsigned long long entity_start, unsigned long long entities,
-                          unsigned long long min_span, 
-                          std::vector<json>&msg_slice,
+                         std::set<int>& function_ids);
+    void traceBackJSON(unsigned long long start,
+                       unsigned long long entity_start, unsigned long long entity_stop,
+                       unsigned long long min_span,
+                       unsigned long long taskid, unsigned long long task_time,
+                       bool full_traceback,
+                       std::vector<json>& msg_slice,
+                       std::vector<json>& evt_slice,
+                       std::set<uint64_t>& evt_set,
+                       std::set<int>& function_ids,
+                       bool logging);
+    void msgTraceBackJSON(CommEvent * focus, bool full_traceback,
+                          unsigned long long start,
+                          unsigned long long min_span,
+                          std::vector<json>& msg_slice,
                           std::vector<json>& evt_slice,
                           std::set<uint64_t>& evt_set,
-                          std::map<std::string, Function *>& function_names,
+                          std::set<int>& function_ids,
+                          std::vector<unsigned long>& expanded,
                           bool logging);
     static const bool debug = false;
     static const int partition_portion = 25;
     static const int lateness_portion = 45;
     static const int steps_portion = 30;
     static const std::string collectives_string;
+    static const unsigned long long lod_buckets = 4096; // Across the trace at the finest level
+    static const unsigned long long overview_bins = 8192; // Resolution of utilization tables
+    static const unsigned long long imbalance_bins = 2048; // Per entity, so coarser
+    static const unsigned long long row_bins = 2048; // Per entity, for row summaries
+    static const unsigned long max_search_limit = 10000; // Matches per search page
+    static const unsigned int search_chunk = 256; // Events matched at a time
+    static const unsigned long max_gap_limit = 10000; // Gaps per idle gap query
 
     static const unsigned long traceback_off = 0;
     static const unsigned long traceback_single = 1;
     static const unsigned long traceback_full = 2;
+
+    static const unsigned char wait_none = 0;
+    static const unsigned char wait_late_sender = 1; // Receive entered before the send
+    static const unsigned char wait_late_receiver = 2; // Send entered before the receive
+    static const unsigned char wait_collective = 3; // Entered before the last participant
 };
 
 #endif // TRACE_H